@@ -0,0 +1,176 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/Json.h"
+
+/*
+ * 吞吐量测试，同时也是 PGO 的训练负载。
+ * 语料由固定种子生成，覆盖常见的几类文档：记录数组、大量数字、带转义的字符串、大量小消息、深层嵌套。
+ * 用法：SJsonBench [--train] [轮数]，--train 只运行不输出，供 -fprofile-generate 构建收集 profile。
+ */
+using namespace SJson;
+
+struct Corpus
+{
+    const char *name;
+    std::vector<std::string> docs;
+    size_t bytes = 0;
+};
+
+static std::mt19937 rng(20240601);
+
+static std::string random_word(size_t min, size_t max)
+{
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    std::string word(std::uniform_int_distribution<size_t>(min, max)(rng), 'a');
+    for (auto &ch : word)
+        ch = letters[rng() % (sizeof(letters) - 1)];
+    return word;
+}
+
+static std::string random_number()
+{
+    char buffer[32];
+    switch (rng() % 3)
+    {
+    case 0:
+        snprintf(buffer, sizeof(buffer), "%u", unsigned(rng() % 100000));
+        break;
+    case 1:
+        snprintf(buffer, sizeof(buffer), "%.6f", std::uniform_real_distribution<double>(-1e4, 1e4)(rng));
+        break;
+    default:
+        snprintf(buffer, sizeof(buffer), "%.3e", std::uniform_real_distribution<double>(-1e10, 1e10)(rng));
+        break;
+    }
+    return buffer;
+}
+
+static std::string make_record(int id)
+{
+    std::string s = "{\"id\":" + std::to_string(id) +
+                    ",\"name\":\"" + random_word(4, 16) +
+                    "\",\"email\":\"" + random_word(6, 12) + "@example.com\"" +
+                    ",\"score\":" + random_number() +
+                    ",\"active\":" + (rng() % 2 ? "true" : "false") +
+                    ",\"parent\":null,\"tags\":[";
+    for (unsigned i = 0, n = rng() % 5; i < n; ++i)
+        s += (i ? ",\"" : "\"") + random_word(3, 8) + "\"";
+    s += "],\"address\":{\"city\":\"" + random_word(5, 10) + "\",\"zip\":\"" + std::to_string(rng() % 100000) + "\"}}";
+    return s;
+}
+
+static void add_doc(Corpus &c, std::string doc)
+{
+    c.bytes += doc.size();
+    c.docs.push_back(std::move(doc));
+}
+
+static std::vector<Corpus> make_corpora()
+{
+    std::vector<Corpus> corpora;
+
+    Corpus records{"records", {}};
+    std::string doc = "[";
+    for (int i = 0; i < 5000; ++i)
+        doc += (i ? "," : "") + make_record(i);
+    add_doc(records, doc + "]");
+    corpora.push_back(std::move(records));
+
+    Corpus numbers{"numbers", {}};
+    doc = "[";
+    for (int i = 0; i < 100000; ++i)
+        doc += (i ? "," : "") + random_number();
+    add_doc(numbers, doc + "]");
+    corpora.push_back(std::move(numbers));
+
+    Corpus strings{"strings", {}};
+    doc = "[";
+    for (int i = 0; i < 20000; ++i)
+    {
+        std::string s = random_word(8, 64);
+        if (i % 3 == 0)
+            s += "\\n\\t\\\"quoted\\\"";
+        if (i % 5 == 0)
+            s += "\\u4e2d\\u6587 \\ud83d\\ude00";
+        doc += (i ? ",\"" : "\"") + s + "\"";
+    }
+    add_doc(strings, doc + "]");
+    corpora.push_back(std::move(strings));
+
+    Corpus messages{"messages", {}};
+    for (int i = 0; i < 20000; ++i)
+        add_doc(messages, make_record(i));
+    corpora.push_back(std::move(messages));
+
+    Corpus nested{"nested", {}};
+    for (int i = 0; i < 200; ++i)
+    {
+        std::string s;
+        for (int d = 0; d < 64; ++d)
+            s += d % 2 ? "[" : "{\"k\":";
+        s += "1";
+        for (int d = 63; d >= 0; --d)
+            s += d % 2 ? "]" : "}";
+        add_doc(nested, s);
+    }
+    corpora.push_back(std::move(nested));
+    return corpora;
+}
+
+int main(int argc, char *argv[])
+{
+    bool train = false;
+    int rounds = 5;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--train") == 0)
+            train = true;
+        else
+            rounds = atoi(argv[i]);
+    }
+    if (rounds <= 0)
+        rounds = 1;
+
+    std::vector<Corpus> corpora = make_corpora();
+    if (!train)
+        printf("%-10s %12s %12s\n", "corpus", "parse MB/s", "stringify MB/s");
+    using Clock = std::chrono::steady_clock;
+    for (const auto &c : corpora)
+    {
+        std::vector<Json> values(c.docs.size());
+        std::string status, out;
+        double parseTime = 0, stringifyTime = 0;
+        size_t outBytes = 0;
+        for (int r = 0; r < rounds; ++r)
+        {
+            auto t0 = Clock::now();
+            for (size_t i = 0; i < c.docs.size(); ++i)
+            {
+                values[i].Parse(c.docs[i], status);
+                if (status != "parse ok")
+                {
+                    fprintf(stderr, "%s: %s\n", c.name, status.c_str());
+                    return 1;
+                }
+            }
+            auto t1 = Clock::now();
+            outBytes = 0;
+            for (const auto &v : values)
+            {
+                v.Stringify(out);
+                outBytes += out.size();
+            }
+            auto t2 = Clock::now();
+            parseTime += std::chrono::duration<double>(t1 - t0).count();
+            stringifyTime += std::chrono::duration<double>(t2 - t1).count();
+        }
+        if (!train)
+            printf("%-10s %12.1f %12.1f\n", c.name,
+                   c.bytes * rounds / parseTime / 1e6, outBytes * rounds / stringifyTime / 1e6);
+    }
+    return 0;
+}
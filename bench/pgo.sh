@@ -0,0 +1,43 @@
+#!/bin/sh
+# 两步 PGO 构建，并输出优化前后的吞吐量对比
+#   1、Release 基线构建
+#   2、SJSON_PGO=GENERATE 构建，运行训练负载收集 profile
+#   3、在同一个构建目录中以 SJSON_PGO=USE 重新构建（同时开启 LTO）；gcc 按目标文件的路径查找 profile，因此不能换目录
+# 用法：bench/pgo.sh [构建目录，默认 _pgo] [测试轮数，默认 5]
+set -e
+SRC=$(cd "$(dirname "$0")/.." && pwd)
+OUT=$(mkdir -p "${1:-$SRC/_pgo}" && cd "${1:-$SRC/_pgo}" && pwd)
+ROUNDS=${2:-5}
+PROFILE="$OUT/profile"
+JOBS=$(nproc 2>/dev/null || echo 4)
+
+# configure <目录名> <cmake 参数...>
+configure() {
+    dir="$OUT/$1"
+    shift
+    cmake -S "$SRC" -B "$dir" -DCMAKE_BUILD_TYPE=Release -DTEST_ENABLE=OFF -DSJSON_BENCH=ON "$@" >/dev/null
+    cmake --build "$dir" -j"$JOBS" >/dev/null
+}
+
+echo "== baseline (Release)"
+configure base -DSJSON_LTO=OFF -DSJSON_PGO=OFF
+
+echo "== instrumented build and training run"
+rm -rf "$PROFILE"
+configure pgo -DSJSON_LTO=ON -DSJSON_PGO=GENERATE -DSJSON_PGO_DIR="$PROFILE"
+"$OUT/pgo/bench/SJsonBench" --train 3
+if ls "$PROFILE"/*.profraw >/dev/null 2>&1; then
+    # clang：合并原始 profile
+    llvm-profdata merge -o "$PROFILE/default.profdata" "$PROFILE"/*.profraw
+fi
+
+echo "== optimized build (LTO + PGO)"
+configure pgo -DSJSON_LTO=ON -DSJSON_PGO=USE -DSJSON_PGO_DIR="$PROFILE"
+
+"$OUT/base/bench/SJsonBench" "$ROUNDS" >"$OUT/base.txt"
+"$OUT/pgo/bench/SJsonBench" "$ROUNDS" >"$OUT/pgo.txt"
+
+echo "== throughput (MB/s)"
+paste "$OUT/base.txt" "$OUT/pgo.txt" | awk '
+    NR == 1 { printf "%-10s %10s %10s %8s %10s %10s %8s\n", "corpus", "parse", "pgo", "speedup", "stringify", "pgo", "speedup"; next }
+    { printf "%-10s %10.1f %10.1f %7.2fx %10.1f %10.1f %7.2fx\n", $1, $2, $5, $5 / $2, $3, $6, $6 / $3 }'
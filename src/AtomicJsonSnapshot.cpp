@@ -0,0 +1,159 @@
+#include "AtomicJsonSnapshot.h"
+#include "JsonBatch.h"
+#include "JsonException.h"
+
+namespace SJson
+{
+    namespace JsonEpoch
+    {
+        /* 每个线程一条读者记录，独占一个缓存行；epoch 为 0 表示没有进行中的读 */
+        struct alignas(64) ReaderRecord
+        {
+            std::atomic<uint64_t> epoch{0};
+            std::atomic<bool> inUse{true};
+            /* 同一线程嵌套的读只在最外层登记 */
+            unsigned nesting = 0;
+            ReaderRecord *next = nullptr;
+        };
+
+        namespace
+        {
+            /* 所有 AtomicJsonSnapshot 共用一个 epoch 和一张读者记录表；记录只增不删，线程退出后留给新线程复用 */
+            std::atomic<uint64_t> g_epoch{1};
+            std::atomic<ReaderRecord *> g_records{nullptr};
+
+            ReaderRecord *AcquireRecord()
+            {
+                for (ReaderRecord *r = g_records.load(std::memory_order_acquire); r != nullptr; r = r->next)
+                {
+                    bool used = false;
+                    if (!r->inUse.load(std::memory_order_relaxed) &&
+                        r->inUse.compare_exchange_strong(used, true, std::memory_order_acquire))
+                        return r;
+                }
+                ReaderRecord *r = new ReaderRecord;
+                r->next = g_records.load(std::memory_order_relaxed);
+                while (!g_records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed))
+                    ;
+                return r;
+            }
+
+            struct LocalRecord
+            {
+                ReaderRecord *record = AcquireRecord();
+                ~LocalRecord()
+                {
+                    record->epoch.store(0, std::memory_order_release);
+                    record->inUse.store(false, std::memory_order_release);
+                }
+            };
+
+            ReaderRecord &Local()
+            {
+                thread_local LocalRecord local;
+                return *local.record;
+            }
+
+            /* 进行中的读所登记的最小 epoch，没有读者时返回 UINT64_MAX */
+            uint64_t MinActiveEpoch() noexcept
+            {
+                uint64_t min = UINT64_MAX;
+                for (ReaderRecord *r = g_records.load(std::memory_order_acquire); r != nullptr; r = r->next)
+                {
+                    uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+                    if (e != 0 && e < min)
+                        min = e;
+                }
+                return min;
+            }
+        }
+    }
+
+    AtomicJsonSnapshot::Reader::~Reader() noexcept
+    {
+        if (m_record != nullptr && --m_record->nesting == 0)
+            m_record->epoch.store(0, std::memory_order_release);
+    }
+
+    AtomicJsonSnapshot::AtomicJsonSnapshot() : m_current(new Json) {}
+
+    AtomicJsonSnapshot::AtomicJsonSnapshot(Json json) : m_current(new Json(std::move(json))) {}
+
+    AtomicJsonSnapshot::~AtomicJsonSnapshot() noexcept
+    {
+        delete m_current.load(std::memory_order_relaxed);
+        for (auto &r : m_retired)
+            delete r.second;
+    }
+
+    AtomicJsonSnapshot::Reader AtomicJsonSnapshot::Read() const noexcept
+    {
+        JsonEpoch::ReaderRecord &record = JsonEpoch::Local();
+        // 先登记 epoch 再读取指针，与 Publish 中先替换指针再推进 epoch 的顺序相对：
+        // 若登记的 epoch 不小于某个旧文档的回收 epoch，那么读到的一定是替换之后的指针
+        if (record.nesting++ == 0)
+            record.epoch.store(JsonEpoch::g_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+        return Reader(m_current.load(std::memory_order_seq_cst), &record);
+    }
+
+    void AtomicJsonSnapshot::Publish(Json json)
+    {
+        const Json *doc = new Json(std::move(json));
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        const Json *old = m_current.exchange(doc, std::memory_order_seq_cst);
+        // 之后登记的读者 epoch 都不小于 retired，一定看不到 old
+        uint64_t retired = JsonEpoch::g_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        m_retired.emplace_back(retired, old);
+        ReclaimLocked();
+    }
+
+    void AtomicJsonSnapshot::Publish(const std::string &content, std::string &status) noexcept
+    {
+        try
+        {
+            Json json;
+            json.Parse(content);
+            Publish(std::move(json));
+            status = "parse ok";
+        }
+        catch (const JsonException &msg)
+        {
+            status = msg.what();
+        }
+        catch (...)
+        {
+            // 内存不足等非解析错误：原文档保持不变，但不能留下上一次的状态；连状态都写不进时清空
+            try
+            {
+                status = JsonStatus::Message(JsonStatus::Unknown);
+            }
+            catch (...)
+            {
+                status.clear();
+            }
+        }
+    }
+
+    size_t AtomicJsonSnapshot::Reclaim() noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        ReclaimLocked();
+        return m_retired.size();
+    }
+
+    void AtomicJsonSnapshot::ReclaimLocked() noexcept
+    {
+        if (m_retired.empty())
+            return;
+        uint64_t min = JsonEpoch::MinActiveEpoch();
+        size_t kept = 0;
+        for (auto &r : m_retired)
+        {
+            if (r.first <= min)
+                delete r.second;
+            else
+                m_retired[kept++] = r;
+        }
+        m_retired.resize(kept);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef ATOMICJSONSNAPSHOT_H
+#define ATOMICJSONSNAPSHOT_H
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Json.h"
+
+namespace SJson
+{
+    namespace JsonEpoch
+    {
+        struct ReaderRecord;
+    }
+
+    /*
+     * 可原子替换的只读文档，适合每个请求都要读取、定期重新加载的配置：
+     *   读：Read() 返回的 Reader 持有当前文档的引用，只写本线程独占的记录（一条 xchg），不修改任何共享的缓存行，
+     *       没有循环重试，读的开销与线程数无关；
+     *   写：Publish() 原子地换上新文档，旧文档挂到待回收列表，等到所有在替换之前开始的读都结束后才释放（基于 epoch 的延迟回收）。
+     * 读者拿到的是 const Json，持有 Reader 期间文档不会被释放；Reader 不能跨线程传递，也不应长期持有，否则旧文档无法回收。
+     * 析构时不能再有读者。
+     */
+    class AtomicJsonSnapshot
+    {
+    public:
+        class Reader
+        {
+        public:
+            Reader(Reader &&rhs) noexcept : m_doc(rhs.m_doc), m_record(rhs.m_record) { rhs.m_record = nullptr; }
+            Reader(const Reader &) = delete;
+            Reader &operator=(const Reader &) = delete;
+            Reader &operator=(Reader &&) = delete;
+            ~Reader() noexcept;
+
+            const Json &operator*() const noexcept { return *m_doc; }
+            const Json *operator->() const noexcept { return m_doc; }
+            const Json &Get() const noexcept { return *m_doc; }
+
+        private:
+            Reader(const Json *doc, JsonEpoch::ReaderRecord *record) noexcept : m_doc(doc), m_record(record) {}
+            const Json *m_doc;
+            JsonEpoch::ReaderRecord *m_record;
+            friend class AtomicJsonSnapshot;
+        };
+
+        /* 初始为 null 文档 */
+        AtomicJsonSnapshot();
+        explicit AtomicJsonSnapshot(Json json);
+        ~AtomicJsonSnapshot() noexcept;
+        AtomicJsonSnapshot(const AtomicJsonSnapshot &) = delete;
+        AtomicJsonSnapshot &operator=(const AtomicJsonSnapshot &) = delete;
+
+        /* 取得当前文档的只读引用，无等待 */
+        Reader Read() const noexcept;
+        /* 发布新文档，之后开始的读都会看到它；同时回收已经没有读者的旧文档 */
+        void Publish(Json json);
+        /* 解析 content 并发布，解析失败时保持原文档不变 */
+        void Publish(const std::string &content, std::string &status) noexcept;
+        /* 回收已经没有读者的旧文档，返回仍在等待回收的个数 */
+        size_t Reclaim() noexcept;
+
+    private:
+        void ReclaimLocked() noexcept;
+
+        std::atomic<const Json *> m_current;
+        /* 写者之间互斥，保护待回收列表：(替换时的 epoch, 旧文档) */
+        std::mutex m_writeMutex;
+        std::vector<std::pair<uint64_t, const Json *>> m_retired;
+    };
+}
+#endif // ATOMICJSONSNAPSHOT_H
@@ -1,38 +1,90 @@
 #include "Json.h"
 #include "JsonValue.h"
 #include "JsonException.h"
+#include "JsonPatch.h"
+#include "JsonDiff.h"
+#include "JsonBatch.h"
 namespace SJson
 {
-    Json::Json() noexcept : m_Value(new JsonValue) {}
-    Json::~Json() noexcept {}
+    namespace
+    {
+        inline JsonValue MakeBoolean(bool b) noexcept
+        {
+            JsonValue v;
+            v.SetType(b ? JsonType::True : JsonType::False);
+            return v;
+        }
+        inline JsonValue MakeNumber(double d) noexcept
+        {
+            JsonValue v;
+            v.SetNumber(d);
+            return v;
+        }
+        inline JsonValue MakeInt64(int64_t i) noexcept
+        {
+            JsonValue v;
+            v.SetInt64(i);
+            return v;
+        }
+        inline JsonValue MakeUint64(uint64_t u) noexcept
+        {
+            JsonValue v;
+            v.SetUint64(u);
+            return v;
+        }
+        inline JsonValue MakeString(std::string &&str) noexcept
+        {
+            JsonValue v;
+            v.SetString(std::move(str));
+            return v;
+        }
+    }
+
+    static_assert(sizeof(JsonValue) <= sizeof(Json) && alignof(JsonValue) <= alignof(Json),
+                  "JsonValue must fit in the inline storage of Json");
+
+    // JsonValue 直接构造在 m_storage 中，构造、拷贝、移动都不再分配内存
+    Json::Json() noexcept
+    {
+        new (&m_storage) JsonValue();
+    }
+    Json::Json(const JsonValue &val) noexcept
+    {
+        new (&m_storage) JsonValue(val);
+    }
+    Json::~Json() noexcept
+    {
+        Value().~JsonValue();
+    }
     Json::Json(const Json &rhs) noexcept
     {
-        m_Value.reset(new JsonValue(*(rhs.m_Value)));
+        new (&m_storage) JsonValue(rhs.Value());
     }
     Json &Json::operator=(const Json &rhs) noexcept
     {
         if (this == &rhs)
             return *this;
-        m_Value.reset(new JsonValue(*(rhs.m_Value)));
+        Value() = rhs.Value();
         return *this;
     }
     Json::Json(Json &&rhs) noexcept
     {
-        m_Value.reset(rhs.m_Value.release());
+        // 接管 rhs 的负载，rhs 变为 null
+        new (&m_storage) JsonValue(std::move(rhs.Value()));
     }
 
     Json &Json::operator=(Json &&rhs) noexcept
     {
-        // rhs.m_Value.release() 返回它管理的指针，转移所有权，所以不对这个指针delete，并且rhs的m_Value定义为nullptr
-        // 当前类的m_Value原来管理的指针释放掉（使用delete1），而改为指向rhs.m_Value.release的指针
-
-        m_Value.reset(rhs.m_Value.release());
+        if (this == &rhs)
+            return *this;
+        Value() = std::move(rhs.Value());
         return *this;
     }
     void Json::swap(Json &rhs) noexcept
     {
-        using std::swap;
-        swap(m_Value, rhs.m_Value);
+        JsonValue tmp(std::move(Value()));
+        Value() = std::move(rhs.Value());
+        rhs.Value() = std::move(tmp);
     }
 
     void Json::Parse(const std::string &content, std::string &status) noexcept
@@ -53,17 +105,17 @@ namespace SJson
 
     void Json::Parse(const std::string &content)
     {
-        m_Value->Parse(content);
+        Value().Parse(content);
     }
 
     bool operator==(const Json &lhs, const Json &rhs) noexcept
     {
-        return *(lhs.m_Value) == *(rhs.m_Value);
+        return lhs.Value() == rhs.Value();
     }
 
     bool operator!=(const Json &lhs, const Json &rhs) noexcept
     {
-        return *(lhs.m_Value) != *(rhs.m_Value);
+        return lhs.Value() != rhs.Value();
     }
 
     void swap(Json &lhs, Json &rhs) noexcept
@@ -73,111 +125,252 @@ namespace SJson
 
     int Json::GetType() const noexcept
     {
-        if (m_Value == nullptr)
-            return JsonType::Null;
-        return m_Value->GetType();
+        return Value().GetType();
     }
     void Json::SetNull() noexcept
     {
-        m_Value->SetType(JsonType::Null);
+        Value().SetType(JsonType::Null);
     }
     void Json::SetBoolean(bool b) noexcept
     {
         if (b)
-            m_Value->SetType(JsonType::True);
+            Value().SetType(JsonType::True);
         else
-            m_Value->SetType(JsonType::False);
+            Value().SetType(JsonType::False);
     }
     double Json::GetNumber() const noexcept
     {
-        return m_Value->GetNumber();
+        return Value().GetNumber();
     }
     void Json::SetNumber(double d) noexcept
     {
-        m_Value->SetNumber(d);
+        Value().SetNumber(d);
+    }
+    int Json::GetNumberKind() const noexcept
+    {
+        return Value().GetNumberKind();
+    }
+    int64_t Json::GetInt64() const noexcept
+    {
+        return Value().GetInt64();
+    }
+    uint64_t Json::GetUint64() const noexcept
+    {
+        return Value().GetUint64();
+    }
+    void Json::SetInt64(int64_t i) noexcept
+    {
+        Value().SetInt64(i);
+    }
+    void Json::SetUint64(uint64_t u) noexcept
+    {
+        Value().SetUint64(u);
     }
     const std::string Json::GetString() const noexcept
     {
-        return m_Value->GetString();
+        return Value().GetString();
     }
     void Json::SetString(const std::string &str) noexcept
     {
-        m_Value->SetString(str);
+        Value().SetString(str);
+    }
+    void Json::SetString(std::string &&str) noexcept
+    {
+        Value().SetString(std::move(str));
     }
     size_t Json::GetArraySize() const noexcept
     {
-        return m_Value->GetArraySize();
+        return Value().GetArraySize();
     }
     Json Json::GetArrayElement(size_t index) const noexcept
     {
-        Json ret;
-        ret.m_Value.reset(new JsonValue(m_Value->GetArrayElement(index)));
-        return ret;
+        return Json(Value().GetArrayElement(index));
     }
     void Json::SetArray() noexcept
     {
-        m_Value->SetArray(std::vector<JsonValue>{});
+        Value().SetArray(std::vector<JsonValue>{});
     }
     void Json::PushbackArrayElement(const Json &val) noexcept
     {
-        m_Value->PushbackArrayElement(*val.m_Value);
+        Value().PushbackArrayElement(val.Value());
     }
     void Json::PopbackArrayElement() noexcept
     {
-        m_Value->PopbackArrayElement();
+        Value().PopbackArrayElement();
     }
     void Json::EraseArrayElement(size_t index, size_t count) noexcept
     {
-        m_Value->EraseArrayElement(index, count);
+        Value().EraseArrayElement(index, count);
     }
     void Json::InsertArrayElement(const Json &val, size_t index) noexcept
     {
-        m_Value->InsertArrayElement(*val.m_Value, index);
+        Value().InsertArrayElement(val.Value(), index);
+    }
+    void Json::PushbackArrayElement(Json &&val) noexcept
+    {
+        Value().PushbackArrayElement(std::move(val.Value()));
+    }
+    void Json::InsertArrayElement(Json &&val, size_t index) noexcept
+    {
+        Value().InsertArrayElement(std::move(val.Value()), index);
+    }
+    void Json::EmplaceArrayElement(std::nullptr_t) noexcept
+    {
+        Value().PushbackArrayElement(JsonValue());
+    }
+    void Json::EmplaceArrayElement(bool b) noexcept
+    {
+        Value().PushbackArrayElement(MakeBoolean(b));
+    }
+    void Json::EmplaceArrayElement(double d) noexcept
+    {
+        Value().PushbackArrayElement(MakeNumber(d));
+    }
+    void Json::EmplaceArrayInt64(int64_t i) noexcept
+    {
+        Value().PushbackArrayElement(MakeInt64(i));
+    }
+    void Json::EmplaceArrayUint64(uint64_t u) noexcept
+    {
+        Value().PushbackArrayElement(MakeUint64(u));
+    }
+    void Json::EmplaceArrayElement(std::string str) noexcept
+    {
+        Value().PushbackArrayElement(MakeString(std::move(str)));
     }
     void Json::ClearArray() noexcept
     {
-        m_Value->ClearArray();
+        Value().ClearArray();
     }
     void Json::SetObject() noexcept
     {
-        m_Value->SetObject(std::vector<std::pair<std::string, JsonValue>>{});
+        Value().SetObject(std::vector<std::pair<std::string, JsonValue>>{});
     }
     size_t Json::GetObjectSize() const noexcept
     {
-        return m_Value->GetObjectSize();
+        return Value().GetObjectSize();
     }
     const std::string &Json::GetObjectKey(size_t index) const noexcept
     {
-        return m_Value->GetObjectKey(index);
+        return Value().GetObjectKey(index);
     }
     Json Json::GetObjectValue(size_t index) const noexcept
     {
-        Json ret;
-        ret.m_Value.reset(new JsonValue(m_Value->GetObjectValue(index)));
-        return ret;
+        return Json(Value().GetObjectValue(index));
     }
     size_t Json::GetObjectKeyLength(size_t index) const noexcept
     {
-        return m_Value->GetObjectKeyLength(index);
+        return Value().GetObjectKeyLength(index);
     }
     void Json::SetObjectValue(const std::string &key, const Json &val) noexcept
     {
-        m_Value->SetObjectValue(key, *val.m_Value);
+        Value().SetObjectValue(key, val.Value());
+    }
+    void Json::SetObjectValue(const std::string &key, Json &&val) noexcept
+    {
+        Value().SetObjectValue(key, std::move(val.Value()));
+    }
+    void Json::EmplaceObjectValue(std::string key, std::nullptr_t) noexcept
+    {
+        Value().EmplaceObjectValue(std::move(key), JsonValue());
+    }
+    void Json::EmplaceObjectValue(std::string key, bool b) noexcept
+    {
+        Value().EmplaceObjectValue(std::move(key), MakeBoolean(b));
+    }
+    void Json::EmplaceObjectValue(std::string key, double d) noexcept
+    {
+        Value().EmplaceObjectValue(std::move(key), MakeNumber(d));
+    }
+    void Json::EmplaceObjectInt64(std::string &&key, int64_t i) noexcept
+    {
+        Value().EmplaceObjectValue(std::move(key), MakeInt64(i));
+    }
+    void Json::EmplaceObjectUint64(std::string &&key, uint64_t u) noexcept
+    {
+        Value().EmplaceObjectValue(std::move(key), MakeUint64(u));
+    }
+    void Json::EmplaceObjectValue(std::string key, std::string str) noexcept
+    {
+        Value().EmplaceObjectValue(std::move(key), MakeString(std::move(str)));
+    }
+    void Json::EmplaceObjectValue(std::string key, Json &&val) noexcept
+    {
+        Value().EmplaceObjectValue(std::move(key), std::move(val.Value()));
+    }
+    void Json::Reserve(size_t capacity) noexcept
+    {
+        Value().Reserve(capacity);
     }
     long long Json::FindObjectIndex(const std::string &key) const noexcept
     {
-        return m_Value->FindObjectIndex(key);
+        return Value().FindObjectIndex(key);
     }
     void Json::RemoveObjectValue(size_t index) noexcept
     {
-        m_Value->RemoveObjectValue(index);
+        Value().RemoveObjectValue(index);
     }
     void Json::ClearObject() noexcept
     {
-        m_Value->ClearObject();
+        Value().ClearObject();
     }
     void Json::Stringify(std::string &content) const noexcept
     {
-        m_Value->Stringify(content);
+        Value().Stringify(content);
+    }
+    void Json::ApplyPatch(const Json &patch)
+    {
+        JsonPatcher(Value()).Apply(patch.Value());
+    }
+    void Json::ApplyPatch(const Json &patch, std::string &status) noexcept
+    {
+        try
+        {
+            ApplyPatch(patch);
+            status = "patch ok";
+        }
+        catch (const JsonException &msg)
+        {
+            status = msg.what();
+        }
+        catch (...)
+        {
+            // patch 已经回滚，不能留下上一次的 "patch ok"
+            try
+            {
+                status = JsonStatus::Message(JsonStatus::Unknown);
+            }
+            catch (...)
+            {
+                status.clear();
+            }
+        }
+    }
+    void Json::ApplyMergePatch(const Json &patch) noexcept
+    {
+        JsonPatcher(Value()).Merge(patch.Value());
+    }
+    void Json::Diff(const Json &target, Json &patch) const noexcept
+    {
+        JsonDiffer(patch.Value()).Diff(Value(), target.Value());
+    }
+    size_t Json::Hash() const noexcept
+    {
+        return Value().Hash();
+    }
+    void Json::GetStats(JsonStats &stats) const noexcept
+    {
+        stats = JsonStats();
+        Value().CollectStats(stats);
+    }
+    size_t Json::MemoryUsage() const noexcept
+    {
+        JsonStats stats;
+        Value().CollectStats(stats);
+        return sizeof(Json) + stats.bytesAllocated;
+    }
+    void Json::Compact() noexcept
+    {
+        Value().Compact();
     }
 }
@@ -1,7 +1,11 @@
 #ifndef JSON_H
 #define JSON_H
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
+#include <type_traits>
 
 namespace SJson
 {
@@ -18,6 +22,33 @@ namespace SJson
             Object
         };
     }
+    /* 数字的表示：整数在范围内时按 int64、uint64 原样保存，不经过 double */
+    namespace JsonNumberKind
+    {
+        enum kind : int
+        {
+            Double,
+            Int64,
+            Uint64
+        };
+    }
+
+    /* 内存统计：由 Json::GetStats 或设置了 JsonParser::SetStats 的解析填充 */
+    struct JsonStats
+    {
+        /* 按类型统计的节点个数，下标为 JsonType */
+        size_t nodes[7] = {};
+        /* 字符串与 key 的字节数（不含 '\0'） */
+        size_t stringBytes = 0;
+        /* 容器与字符串 capacity - size 浪费的字节数 */
+        size_t slackBytes = 0;
+        /* 堆上分配的块数与字节数，被共享的负载只计一次 */
+        size_t allocations = 0;
+        size_t bytesAllocated = 0;
+        /* 解析时从回收池中复用的负载个数 */
+        size_t reusedBlocks = 0;
+    };
+
     class JsonValue;
     class Json final
     {
@@ -52,15 +83,27 @@ namespace SJson
             SetNumber(d);
             return *this;
         }
+        /* 64 位整数：GetInt64、GetUint64 对其他表示做饱和转换 */
+        int GetNumberKind() const noexcept;
+        int64_t GetInt64() const noexcept;
+        uint64_t GetUint64() const noexcept;
+        void SetInt64(int64_t i) noexcept;
+        void SetUint64(uint64_t u) noexcept;
 
         /* string */
         const std::string GetString() const noexcept;
         void SetString(const std::string &str) noexcept;
+        void SetString(std::string &&str) noexcept;
         Json &operator=(const std::string &str) noexcept
         {
             SetString(str);
             return *this;
         }
+        Json &operator=(std::string &&str) noexcept
+        {
+            SetString(std::move(str));
+            return *this;
+        }
 
         /* array */
         size_t GetArraySize() const noexcept;
@@ -70,7 +113,24 @@ namespace SJson
         void PopbackArrayElement() noexcept;
         void EraseArrayElement(size_t index, size_t count) noexcept;
         void InsertArrayElement(const Json &val, size_t index) noexcept;
+        /* 右值版本接管 val 的负载，不增加引用计数，之后修改父节点也不会触发写时复制；val 变为 null */
+        void PushbackArrayElement(Json &&val) noexcept;
+        void InsertArrayElement(Json &&val, size_t index) noexcept;
         void ClearArray() noexcept;
+        /* 在数组末尾直接构造子节点，不创建临时 Json */
+        void EmplaceArrayElement(std::nullptr_t) noexcept;
+        void EmplaceArrayElement(bool b) noexcept;
+        void EmplaceArrayElement(double d) noexcept;
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+        void EmplaceArrayElement(T v) noexcept
+        {
+            if constexpr (std::is_signed_v<T>)
+                EmplaceArrayInt64(static_cast<int64_t>(v));
+            else
+                EmplaceArrayUint64(static_cast<uint64_t>(v));
+        }
+        void EmplaceArrayElement(std::string str) noexcept;
+        void EmplaceArrayElement(const char *str) noexcept { EmplaceArrayElement(std::string(str)); }
         /* object */
         void SetObject() noexcept;
         size_t GetObjectSize() const noexcept;
@@ -78,20 +138,77 @@ namespace SJson
         Json GetObjectValue(size_t index) const noexcept;
         size_t GetObjectKeyLength(size_t index) const noexcept;
         void SetObjectValue(const std::string &key, const Json &val) noexcept;
+        void SetObjectValue(const std::string &key, Json &&val) noexcept;
+        /* 在对象末尾直接构造成员：不查找同名的 key，由调用者保证 key 不重复，因此每次追加都是 O(1) */
+        void EmplaceObjectValue(std::string key, std::nullptr_t) noexcept;
+        void EmplaceObjectValue(std::string key, bool b) noexcept;
+        void EmplaceObjectValue(std::string key, double d) noexcept;
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+        void EmplaceObjectValue(std::string key, T v) noexcept
+        {
+            if constexpr (std::is_signed_v<T>)
+                EmplaceObjectInt64(std::move(key), static_cast<int64_t>(v));
+            else
+                EmplaceObjectUint64(std::move(key), static_cast<uint64_t>(v));
+        }
+        void EmplaceObjectValue(std::string key, std::string str) noexcept;
+        void EmplaceObjectValue(std::string key, const char *str) noexcept { EmplaceObjectValue(std::move(key), std::string(str)); }
+        void EmplaceObjectValue(std::string key, Json &&val) noexcept;
+        /* 预留数组元素或对象成员的容量，其他类型忽略；与 Emplace、右值版本配合时建树只为每个节点分配一次 */
+        void Reserve(size_t capacity) noexcept;
         long long FindObjectIndex(const std::string &key) const noexcept;
         void RemoveObjectValue(size_t index) noexcept;
         void ClearObject() noexcept;
         /* serialize */
         void Stringify(std::string &content) const noexcept;
+        /* patch：RFC 6902 JSON Patch，全部操作成功才生效，否则文档保持不变 */
+        void ApplyPatch(const Json &patch);
+        void ApplyPatch(const Json &patch, std::string &status) noexcept;
+        /* RFC 7396 JSON Merge Patch */
+        void ApplyMergePatch(const Json &patch) noexcept;
+        /* 生成把当前值变成 target 的 JSON Patch */
+        void Diff(const Json &target, Json &patch) const noexcept;
+        /* 内存统计与整理：MemoryUsage 为整棵树占用的字节数；Compact 去掉容器多余的容量，并按深度优先顺序重新分配节点 */
+        void GetStats(JsonStats &stats) const noexcept;
+        size_t MemoryUsage() const noexcept;
+        void Compact() noexcept;
+        /* 子树哈希：对象与成员顺序无关，结果按节点缓存，修改后失效；可用作缓存的 key */
+        size_t Hash() const noexcept;
 
     private:
-        /* 使用桥接模式，Json暴露给用户，JsonValue来获取具体的值 */
-        std::unique_ptr<JsonValue> m_Value;
+        void EmplaceArrayInt64(int64_t i) noexcept;
+        void EmplaceArrayUint64(uint64_t u) noexcept;
+        void EmplaceObjectInt64(std::string &&key, int64_t i) noexcept;
+        void EmplaceObjectUint64(std::string &&key, uint64_t u) noexcept;
+        /* 使用桥接模式，Json暴露给用户，JsonValue来获取具体的值。
+           JsonValue 直接存放在 Json 内部而不是单独分配，头文件不依赖 JsonValue 的定义，大小在 Json.cpp 中静态检查 */
+        struct alignas(8) Storage
+        {
+            unsigned char bytes[16];
+        };
+        Storage m_storage;
+        explicit Json(const JsonValue &val) noexcept;
+        /* 定义在 JsonValue.h 中 */
+        JsonValue &Value() noexcept;
+        const JsonValue &Value() const noexcept;
         friend bool operator==(const Json &lhs, const Json &rhs) noexcept;
         friend bool operator!=(const Json &lhs, const Json &rhs) noexcept;
+        friend class JsonSnapshot;
+        friend class JsonParser;
+        friend class JsonGenerator;
+        friend class JsonParallelGenerator;
     };
     bool operator==(const Json &lhs, const Json &rhs) noexcept;
     bool operator!=(const Json &lhs, const Json &rhs) noexcept;
     void swap(Json &lhs, Json &rhs) noexcept;
 }
+
+namespace std
+{
+    template <>
+    struct hash<SJson::Json>
+    {
+        size_t operator()(const SJson::Json &json) const noexcept { return json.Hash(); }
+    };
+}
 #endif // JSON_H
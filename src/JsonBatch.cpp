@@ -0,0 +1,161 @@
+#include <cstring>
+#include "JsonBatch.h"
+#include "JsonException.h"
+#include "JsonGenerator.h"
+#include "JsonParser.h"
+namespace SJson
+{
+    namespace JsonStatus
+    {
+        namespace
+        {
+            const char *const kMessages[] = {
+                "parse ok",
+                "parse expect value",
+                "parse invalid value",
+                "parse root not singular",
+                "parse number too big",
+                "parse miss quotation mark",
+                "parse invalid string escape",
+                "parse invalid string char",
+                "parse invalid unicode hex",
+                "parse invalid unicode surrogate",
+                "parse miss comma or square bracket",
+                "parse miss key",
+                "parse miss colon",
+                "parse miss comma or curly bracket",
+                "parse too deep",
+                "parse invalid utf8",
+                "parse limit exceeded",
+                "parse unknown error"};
+        }
+
+        const char *Message(int code) noexcept
+        {
+            if (code < Ok || code > Unknown)
+                code = Unknown;
+            return kMessages[code];
+        }
+
+        code FromMessage(const char *msg) noexcept
+        {
+            for (int i = Ok; i < Unknown; ++i)
+            {
+                if (strcmp(kMessages[i], msg) == 0)
+                    return code(i);
+            }
+            return Unknown;
+        }
+    }
+
+    struct JsonBatch::Worker
+    {
+        JsonParser parser;
+        JsonGenerator generator;
+    };
+
+    JsonBatch::JsonBatch(size_t threads)
+    {
+        if (threads == 0)
+            threads = 1;
+        for (size_t i = 0; i < threads; ++i)
+            m_workers.emplace_back(new Worker);
+        // 第 0 段由调用线程处理，只需要 threads - 1 个后台线程
+        for (size_t i = 1; i < threads; ++i)
+            m_threads.emplace_back(&JsonBatch::WorkerLoop, this, i);
+    }
+
+    JsonBatch::~JsonBatch() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for (auto &t : m_threads)
+            t.join();
+    }
+
+    void JsonBatch::ParseBatch(const std::string *inputs, Json *outputs, size_t count, int *errors) noexcept
+    {
+        Run(count, [&](Worker &w, size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    try
+                    {
+                        w.parser.Parse(outputs[i], inputs[i]);
+                        errors[i] = JsonStatus::Ok;
+                    }
+                    catch (const JsonException &msg)
+                    {
+                        errors[i] = JsonStatus::FromMessage(msg.what());
+                    }
+                    catch (...)
+                    {
+                        errors[i] = JsonStatus::Unknown;
+                    }
+                } });
+    }
+
+    void JsonBatch::StringifyBatch(const Json *inputs, std::string *outputs, size_t count) noexcept
+    {
+        Run(count, [&](Worker &w, size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                    w.generator.Stringify(inputs[i], outputs[i]); });
+    }
+
+    void JsonBatch::Run(size_t count, const std::function<void(Worker &, size_t, size_t)> &task) noexcept
+    {
+        // 批次太小时不值得唤醒线程
+        if (m_threads.empty() || count < 2 * m_workers.size())
+        {
+            task(*m_workers[0], 0, count);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = &task;
+            m_count = count;
+            m_pending = m_threads.size();
+            ++m_generation;
+        }
+        m_start.notify_all();
+        size_t chunk = (count + m_workers.size() - 1) / m_workers.size();
+        task(*m_workers[0], 0, chunk < count ? chunk : count);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]
+                    { return m_pending == 0; });
+        m_task = nullptr;
+    }
+
+    void JsonBatch::WorkerLoop(size_t index) noexcept
+    {
+        size_t seen = 0;
+        for (;;)
+        {
+            const std::function<void(Worker &, size_t, size_t)> *task;
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&]
+                             { return m_stop || m_generation != seen; });
+                if (m_stop)
+                    return;
+                seen = m_generation;
+                task = m_task;
+                count = m_count;
+            }
+            size_t chunk = (count + m_workers.size() - 1) / m_workers.size();
+            size_t begin = index * chunk < count ? index * chunk : count;
+            size_t end = begin + chunk < count ? begin + chunk : count;
+            (*task)(*m_workers[index], begin, end);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_pending;
+            }
+            m_done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef JSONBATCH_H
+#define JSONBATCH_H
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Json.h"
+
+namespace SJson
+{
+    /* 批量解析的逐项结果，与解析错误的提示信息一一对应 */
+    namespace JsonStatus
+    {
+        enum code : int
+        {
+            Ok,
+            ExpectValue,
+            InvalidValue,
+            RootNotSingular,
+            NumberTooBig,
+            MissQuotationMark,
+            InvalidStringEscape,
+            InvalidStringChar,
+            InvalidUnicodeHex,
+            InvalidUnicodeSurrogate,
+            MissCommaOrSquareBracket,
+            MissKey,
+            MissColon,
+            MissCommaOrCurlyBracket,
+            TooDeep,
+            InvalidUtf8,
+            LimitExceeded,
+            Unknown
+        };
+        /* 错误码对应的提示信息，与 Json::Parse 的 status 相同 */
+        const char *Message(int code) noexcept;
+        /* 由提示信息得到错误码，未知的信息返回 Unknown */
+        code FromMessage(const char *msg) noexcept;
+    }
+
+    class JsonParser;
+    class JsonGenerator;
+
+    /*
+     * 批量解析、生成大量小消息：每个工作线程持有一个 JsonParser、JsonGenerator，缓冲区和回收池在批次之间保留，
+     * 解析到已有的 Json 时复用旧文档的负载，不再为每条消息构造解析器、分配 JsonValue 和 status 字符串。
+     * threads > 1 时批次按连续的区间分给固定的线程池，调用线程处理第一段。
+     */
+    class JsonBatch
+    {
+    public:
+        explicit JsonBatch(size_t threads = 1);
+        ~JsonBatch() noexcept;
+        JsonBatch(const JsonBatch &) = delete;
+        JsonBatch &operator=(const JsonBatch &) = delete;
+
+        /* 解析 inputs[0, count) 到 outputs，errors[i] 为 JsonStatus::code */
+        void ParseBatch(const std::string *inputs, Json *outputs, size_t count, int *errors) noexcept;
+        /* 生成 inputs[0, count) 到 outputs，复用 outputs 中字符串的容量 */
+        void StringifyBatch(const Json *inputs, std::string *outputs, size_t count) noexcept;
+
+    private:
+        struct Worker;
+        /* 把 [0, count) 切成与线程数相同的区间并行执行 task(worker, begin, end) */
+        void Run(size_t count, const std::function<void(Worker &, size_t, size_t)> &task) noexcept;
+        void WorkerLoop(size_t index) noexcept;
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_start;
+        std::condition_variable m_done;
+        const std::function<void(Worker &, size_t, size_t)> *m_task = nullptr;
+        size_t m_count = 0;
+        size_t m_generation = 0;
+        size_t m_pending = 0;
+        bool m_stop = false;
+    };
+}
+#endif // JSONBATCH_H
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include "JsonDiff.h"
+namespace SJson
+{
+    namespace
+    {
+        /* LCS 表的最大规模，超过时退化为按位置配对 */
+        const size_t kMaxLcsCells = 1 << 22;
+
+        inline bool Same(const JsonValue &a, const JsonValue &b) noexcept
+        {
+            return a.SharesPayload(b) || a == b;
+        }
+    }
+
+    void JsonDiffer::Diff(const JsonValue &from, const JsonValue &to) noexcept
+    {
+        m_patch.SetArray(JsonArray());
+        m_path.clear();
+        m_tasks.clear();
+        m_tasks.push_back(Task{&from, &to, nullptr, 0, std::string()});
+        while (!m_tasks.empty())
+        {
+            Task task = std::move(m_tasks.back());
+            m_tasks.pop_back();
+            m_path.resize(task.base);
+            m_path += task.token;
+            if (task.op != nullptr)
+                Emit(task.op, task.to);
+            else
+                DiffValue(*task.from, *task.to);
+        }
+        m_output = std::move(m_patch);
+    }
+
+    void JsonDiffer::Schedule(std::vector<Task> &children)
+    {
+        for (size_t i = children.size(); i-- > 0;)
+            m_tasks.push_back(std::move(children[i]));
+    }
+
+    void JsonDiffer::DiffValue(const JsonValue &from, const JsonValue &to)
+    {
+        if (from.SharesPayload(to))
+            return;
+        if (from.GetType() != to.GetType())
+        {
+            Emit("replace", &to);
+            return;
+        }
+        switch (from.GetType())
+        {
+        case JsonType::Number:
+        case JsonType::String:
+            if (!(from == to))
+                Emit("replace", &to);
+            break;
+        case JsonType::Array:
+        case JsonType::Object:
+            // 子树哈希缓存在负载中，相等的子树不再深入，耗时只与变化的部分有关
+            if (from.Hash() == to.Hash() && from == to)
+                break;
+            if (from.GetType() == JsonType::Array)
+                DiffArray(from, to);
+            else
+                DiffObject(from, to);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void JsonDiffer::DiffObject(const JsonValue &from, const JsonValue &to)
+    {
+        // 用哈希表配对 key，避免逐个 FindObjectIndex 的 O(n²)
+        // JSON Pointer 无法区分同名的成员：任一边有重复的 key 时整体替换这个对象，保证 patch 应用后与 to 完全相同
+        std::unordered_map<std::string_view, size_t> toKeys;
+        toKeys.reserve(to.GetObjectSize());
+        for (size_t i = 0, n = to.GetObjectSize(); i < n; ++i)
+        {
+            if (!toKeys.emplace(to.GetObjectKey(i), i).second)
+            {
+                Emit("replace", &to);
+                return;
+            }
+        }
+        std::unordered_set<std::string_view> fromKeys;
+        fromKeys.reserve(from.GetObjectSize());
+        for (size_t i = 0, n = from.GetObjectSize(); i < n; ++i)
+        {
+            if (!fromKeys.insert(from.GetObjectKey(i)).second)
+            {
+                Emit("replace", &to);
+                return;
+            }
+        }
+
+        std::vector<bool> matched(to.GetObjectSize(), false);
+        std::vector<Task> children;
+        size_t base = m_path.size();
+        for (size_t i = 0, n = from.GetObjectSize(); i < n; ++i)
+        {
+            const std::string &key = from.GetObjectKey(i);
+            auto it = toKeys.find(key);
+            if (it == toKeys.end())
+                children.push_back(Task{nullptr, nullptr, "remove", base, KeyToken(key)});
+            else
+            {
+                matched[it->second] = true;
+                children.push_back(Task{&from.GetObjectValue(i), &to.GetObjectValue(it->second), nullptr, base, KeyToken(key)});
+            }
+        }
+        for (size_t i = 0, n = to.GetObjectSize(); i < n; ++i)
+        {
+            if (!matched[i])
+                children.push_back(Task{nullptr, &to.GetObjectValue(i), "add", base, KeyToken(to.GetObjectKey(i))});
+        }
+        Schedule(children);
+    }
+
+    void JsonDiffer::DiffArray(const JsonValue &from, const JsonValue &to)
+    {
+        size_t n = from.GetArraySize(), m = to.GetArraySize();
+        // 去掉相同的前缀和后缀，只有中间变化的部分参与对齐
+        size_t prefix = 0;
+        while (prefix < n && prefix < m && Same(from.GetArrayElement(prefix), to.GetArrayElement(prefix)))
+            ++prefix;
+        size_t suffix = 0;
+        while (suffix < n - prefix && suffix < m - prefix &&
+               Same(from.GetArrayElement(n - 1 - suffix), to.GetArrayElement(m - 1 - suffix)))
+            ++suffix;
+        size_t a = n - prefix - suffix, b = m - prefix - suffix;
+
+        // 编辑脚本：0 保留（配对后继续比较），1 删除 from 中的元素，2 插入 to 中的元素
+        std::vector<char> script;
+        if (a > 0 && b > 0 && a * b <= kMaxLcsCells)
+        {
+            std::vector<size_t> ha(a), hb(b);
+            for (size_t i = 0; i < a; ++i)
+                ha[i] = from.GetArrayElement(prefix + i).Hash();
+            for (size_t j = 0; j < b; ++j)
+                hb[j] = to.GetArrayElement(prefix + j).Hash();
+            // lcs[i][j] 为 ha[i..]、hb[j..] 的最长公共子序列长度
+            std::vector<unsigned> lcs((a + 1) * (b + 1), 0);
+            for (size_t i = a; i-- > 0;)
+                for (size_t j = b; j-- > 0;)
+                    lcs[i * (b + 1) + j] = ha[i] == hb[j] ? lcs[(i + 1) * (b + 1) + j + 1] + 1
+                                                          : std::max(lcs[(i + 1) * (b + 1) + j], lcs[i * (b + 1) + j + 1]);
+            size_t i = 0, j = 0;
+            while (i < a || j < b)
+            {
+                if (i < a && j < b && ha[i] == hb[j])
+                    script.push_back(0), ++i, ++j;
+                else if (j == b || (i < a && lcs[(i + 1) * (b + 1) + j] >= lcs[i * (b + 1) + j + 1]))
+                    script.push_back(1), ++i;
+                else
+                    script.push_back(2), ++j;
+            }
+        }
+        else
+        {
+            // 规模太大时按位置配对
+            script.assign(std::min(a, b), 0);
+            script.insert(script.end(), a > b ? a - b : 0, 1);
+            script.insert(script.end(), b > a ? b - a : 0, 2);
+        }
+
+        // 按编辑脚本生成操作；k 为当前（已部分应用 patch 的）数组中的下标
+        std::vector<Task> children;
+        size_t base = m_path.size();
+        size_t k = prefix, i = prefix, j = prefix;
+        for (size_t s = 0; s < script.size();)
+        {
+            if (script[s] == 0)
+            {
+                children.push_back(Task{&from.GetArrayElement(i), &to.GetArrayElement(j), nullptr, base, IndexToken(k)});
+                ++i, ++j, ++k, ++s;
+                continue;
+            }
+            // 相邻的一段删除和插入：两两配对视为修改，多余的删除或插入单独生成
+            size_t dels = 0, ins = 0;
+            for (size_t t = s; t < script.size() && script[t] != 0; ++t)
+                script[t] == 1 ? ++dels : ++ins;
+            size_t pairs = std::min(dels, ins);
+            for (size_t p = 0; p < pairs; ++p)
+            {
+                children.push_back(Task{&from.GetArrayElement(i), &to.GetArrayElement(j), nullptr, base, IndexToken(k)});
+                ++i, ++j, ++k;
+            }
+            for (size_t p = pairs; p < dels; ++p)
+            {
+                children.push_back(Task{nullptr, nullptr, "remove", base, IndexToken(k)});
+                ++i;
+            }
+            for (size_t p = pairs; p < ins; ++p)
+            {
+                children.push_back(Task{nullptr, &to.GetArrayElement(j), "add", base, IndexToken(k)});
+                ++j, ++k;
+            }
+            s += dels + ins;
+        }
+        Schedule(children);
+    }
+
+    void JsonDiffer::Emit(const char *op, const JsonValue *value)
+    {
+        JsonValue entry, field;
+        entry.SetObject(JsonObject());
+        field.SetString(op);
+        entry.InsertObjectValue(0, "op", std::move(field));
+        field.SetString(m_path);
+        entry.InsertObjectValue(1, "path", std::move(field));
+        if (value != nullptr)
+            entry.InsertObjectValue(2, "value", JsonValue(*value));
+        m_patch.PushbackArrayElement(std::move(entry));
+    }
+
+    std::string JsonDiffer::KeyToken(const std::string &key)
+    {
+        // RFC 6901：'~' 写作 ~0，'/' 写作 ~1
+        std::string token(1, '/');
+        token.reserve(key.size() + 1);
+        for (char ch : key)
+        {
+            if (ch == '~')
+                token += "~0";
+            else if (ch == '/')
+                token += "~1";
+            else
+                token += ch;
+        }
+        return token;
+    }
+
+    std::string JsonDiffer::IndexToken(size_t index)
+    {
+        return '/' + std::to_string(index);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef JSONDIFF_H
+#define JSONDIFF_H
+#include <string>
+#include <vector>
+#include "JsonValue.h"
+
+namespace SJson
+{
+    /*
+     * 计算把 from 变成 to 的 RFC 6902 JSON Patch。
+     * 共享同一份负载的子树（写时复制得到的副本中未修改的部分）直接判定相等，耗时 O(1)；
+     * 子树哈希相等且内容相等的数组、对象不再深入；对象按 key 的哈希表配对，有重复 key 的对象整体替换；
+     * 数组先去掉相同的前缀、后缀，中间部分按子树哈希做 LCS 对齐。
+     */
+    class JsonDiffer
+    {
+    public:
+        explicit JsonDiffer(JsonValue &patch) noexcept : m_output(patch) {}
+        void Diff(const JsonValue &from, const JsonValue &to) noexcept;
+
+    private:
+        /* 待处理的任务：op 为 nullptr 时比较 from 与 to，否则生成操作 op（value 为 to）；
+           路径为父节点路径的前 base 个字符加上 token */
+        struct Task
+        {
+            const JsonValue *from;
+            const JsonValue *to;
+            const char *op;
+            size_t base;
+            std::string token;
+        };
+        void DiffValue(const JsonValue &from, const JsonValue &to);
+        void DiffObject(const JsonValue &from, const JsonValue &to);
+        void DiffArray(const JsonValue &from, const JsonValue &to);
+        /* 追加一个操作，path 为当前的 m_path */
+        void Emit(const char *op, const JsonValue *value);
+        /* 子路径的一段 */
+        static std::string KeyToken(const std::string &key);
+        static std::string IndexToken(size_t index);
+        /* 按顺序加入子节点的任务，倒序压入任务栈，出栈时保持原来的顺序 */
+        void Schedule(std::vector<Task> &children);
+
+        /* 输出可能就是 from 或 to：先生成到 m_patch，全部完成后再移入 m_output */
+        JsonValue &m_output;
+        JsonValue m_patch;
+        std::string m_path;
+        /* 任务栈：不递归，深层嵌套也不会栈溢出 */
+        std::vector<Task> m_tasks;
+    };
+}
+#endif // JSONDIFF_H
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include "JsonFormat.h"
+#include "JsonUtf8.h"
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define SJSON_FORMAT_SSE2
+#endif
+namespace SJson
+{
+    namespace JsonFormat
+    {
+        namespace
+        {
+            /* "00" 到 "99" 的两位数字表 */
+            const char kDigitPairs[201] =
+                "00010203040506070809"
+                "10111213141516171819"
+                "20212223242526272829"
+                "30313233343536373839"
+                "40414243444546474849"
+                "50515253545556575859"
+                "60616263646566676869"
+                "70717273747576777879"
+                "80818283848586878889"
+                "90919293949596979899";
+
+            /* 从缓冲区末尾向前写出 v 的各位，返回第一位的位置 */
+            inline char *FormatUint64(char *end, uint64_t v) noexcept
+            {
+                while (v >= 100)
+                {
+                    unsigned pair = static_cast<unsigned>(v % 100) * 2;
+                    v /= 100;
+                    *--end = kDigitPairs[pair + 1];
+                    *--end = kDigitPairs[pair];
+                }
+                if (v >= 10)
+                {
+                    *--end = kDigitPairs[v * 2 + 1];
+                    *--end = kDigitPairs[v * 2];
+                }
+                else
+                    *--end = static_cast<char>('0' + v);
+                return end;
+            }
+
+            template <bool Ascii>
+            inline bool NeedEscape(unsigned char ch) noexcept
+            {
+                return ch < 0x20 || ch == '\"' || ch == '\\' || (Ascii && ch >= 0x80);
+            }
+
+            /* 跳过不需要转义的连续字符，返回第一个需要转义的位置；有 SSE2 时每次检查 16 字节 */
+            template <bool Ascii>
+            inline const char *SkipPlain(const char *p, const char *end) noexcept
+            {
+#ifdef SJSON_FORMAT_SSE2
+                const __m128i quote = _mm_set1_epi8('\"');
+                const __m128i backslash = _mm_set1_epi8('\\');
+                const __m128i control = _mm_set1_epi8(0x1F);
+                while (end - p >= 16)
+                {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                    __m128i mask = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+                    if constexpr (Ascii)
+                        // 有符号比较：控制字符与大于 0x7F 的字节都小于 0x20
+                        mask = _mm_or_si128(mask, _mm_cmplt_epi8(v, _mm_set1_epi8(0x20)));
+                    else
+                        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+                    int bits = _mm_movemask_epi8(mask);
+                    if (bits != 0)
+                        return p + __builtin_ctz(bits);
+                    p += 16;
+                }
+#endif
+                while (p != end && !NeedEscape<Ascii>(static_cast<unsigned char>(*p)))
+                    ++p;
+                return p;
+            }
+
+            inline void AppendHex4(std::string &res, unsigned u)
+            {
+                static const char kHex[] = "0123456789ABCDEF";
+                char buffer[6] = {'\\', 'u', kHex[(u >> 12) & 0xF], kHex[(u >> 8) & 0xF], kHex[(u >> 4) & 0xF], kHex[u & 0xF]};
+                res.append(buffer, sizeof(buffer));
+            }
+
+            /* 输出 ascii 范围内需要转义的字符 */
+            inline void AppendEscape(std::string &res, unsigned char ch)
+            {
+                switch (ch)
+                {
+                /* 添加这些转义字符 */
+                case '\"':
+                    res += "\\\"";
+                    break;
+                case '\\':
+                    res += "\\\\";
+                    break;
+                case '\b':
+                    res += "\\b";
+                    break;
+                case '\f':
+                    res += "\\f";
+                    break;
+                case '\n':
+                    res += "\\n";
+                    break;
+                case '\r':
+                    res += "\\r";
+                    break;
+                case '\t':
+                    res += "\\t";
+                    break;
+                default:
+                    // 低于 0x20 的字符需要转义为 \u00xx 的形式
+                    AppendHex4(res, ch);
+                }
+            }
+        }
+
+        void AppendString(std::string &res, std::string_view str)
+        {
+            res += '\"';
+            const char *p = str.data(), *end = p + str.size();
+            while (p != end)
+            {
+                // 不需要转义的连续字符整段追加
+                const char *run = p;
+                p = SkipPlain<false>(p, end);
+                res.append(run, p - run);
+                if (p == end)
+                    break;
+                AppendEscape(res, static_cast<unsigned char>(*p++));
+            }
+            res += '\"'; // 添加最后一个双引号
+        }
+
+        void AppendAsciiString(std::string &res, std::string_view str)
+        {
+            res += '\"';
+            const char *p = str.data(), *end = p + str.size();
+            while (p != end)
+            {
+                const char *run = p;
+                p = SkipPlain<true>(p, end);
+                res.append(run, p - run);
+                if (p == end)
+                    break;
+                if (static_cast<unsigned char>(*p) < 0x80)
+                {
+                    AppendEscape(res, static_cast<unsigned char>(*p++));
+                    continue;
+                }
+                unsigned u;
+                size_t n = JsonUtf8::Decode(p, end - p, u);
+                if (n == 0)
+                {
+                    // 非法的字节逐个替换，不影响之后的字符
+                    u = 0xFFFD;
+                    n = 1;
+                }
+                p += n;
+                if (u >= 0x10000)
+                {
+                    u -= 0x10000;
+                    AppendHex4(res, 0xD800 + (u >> 10));
+                    AppendHex4(res, 0xDC00 + (u & 0x3FF));
+                }
+                else
+                    AppendHex4(res, u);
+            }
+            res += '\"';
+        }
+
+        void AppendUint64(std::string &res, uint64_t v)
+        {
+            char buffer[20];
+            char *end = buffer + sizeof(buffer);
+            char *begin = FormatUint64(end, v);
+            res.append(begin, end - begin);
+        }
+
+        void AppendInt64(std::string &res, int64_t v)
+        {
+            char buffer[21];
+            char *end = buffer + sizeof(buffer);
+            // 先转为无符号数再取负，INT64_MIN 也不会溢出
+            uint64_t u = v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+            char *begin = FormatUint64(end, u);
+            if (v < 0)
+                *--begin = '-';
+            res.append(begin, end - begin);
+        }
+
+        void AppendNumber(std::string &res, double d)
+        {
+            char buffer[32] = {0};
+            int n = snprintf(buffer, sizeof(buffer), "%.17g", d);
+            res.append(buffer, n);
+        }
+    }
+}
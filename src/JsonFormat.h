@@ -0,0 +1,32 @@
+#ifndef JSONFORMAT_H
+#define JSONFORMAT_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace SJson
+{
+    /* 输出层：JsonGenerator 与结构体序列化共用的转义、数字格式化函数，结果追加到 res */
+    namespace JsonFormat
+    {
+        /* 生成带引号的字符串，不需要转义的连续字符整段追加 */
+        void AppendString(std::string &res, std::string_view str);
+        /* 只输出 7 位 ascii：非 ascii 字符解码后写成 \uXXXX，超出基本平面的写成代理对，非法的 utf-8 字节写成 \uFFFD */
+        void AppendAsciiString(std::string &res, std::string_view str);
+        /* 生成 double */
+        void AppendNumber(std::string &res, double d);
+        /* 生成整数，不经过 double：查两位数字表，每次输出两位 */
+        void AppendInt64(std::string &res, int64_t v);
+        void AppendUint64(std::string &res, uint64_t v);
+        template <typename T>
+        inline void AppendInteger(std::string &res, T v)
+        {
+            if constexpr (std::is_signed_v<T>)
+                AppendInt64(res, static_cast<int64_t>(v));
+            else
+                AppendUint64(res, static_cast<uint64_t>(v));
+        }
+    }
+}
+#endif // JSONFORMAT_H
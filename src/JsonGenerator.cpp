@@ -1,109 +1,187 @@
 #include "JsonGenerator.h"
+#include "JsonFormat.h"
 #include <cassert>
 namespace SJson
 {
-    JsonGenerator::JsonGenerator(const JsonValue &val, std::string &result) : m_res(result)
+    JsonGenerator::JsonGenerator(const JsonValue &val, std::string &result)
     {
-        m_res.clear();
+        Stringify(val, result);
+    }
+
+    void JsonGenerator::Stringify(const JsonValue &val, std::string &result)
+    {
+        m_res = &result;
+        m_res->clear();
+        m_frames.clear();
+        SJSON_TRACE_RESET(m_profile);
+        SJSON_TRACE_SCOPE(m_profile, Total, result);
         StringifyValue(val);
     }
 
-    /* 生成json的值 */
-    void JsonGenerator::StringifyValue(const JsonValue &val)
+    void JsonGenerator::Stringify(const Json &json, std::string &result)
     {
-        switch (val.GetType())
-        {
-        case JsonType::Null:
-            m_res += "null";
-            break;
-        case JsonType::True:
-            m_res += "true";
-            break;
-        case JsonType::False:
-            m_res += "false";
-            break;
-        case JsonType::Number:
+        Stringify(json.Value(), result);
+    }
+
+    void JsonGenerator::AppendValue(const Json &json, std::string &result)
+    {
+        m_res = &result;
+        m_frames.clear();
+        StringifyValue(json.Value());
+    }
+
+    void JsonGenerator::AppendElements(const JsonValue &container, size_t begin, size_t end, std::string &result)
+    {
+        m_res = &result;
+        m_frames.clear();
+        bool isArray = container.GetType() == JsonType::Array;
+        for (size_t i = begin; i < end; ++i)
         {
-            char buffer[32] = {0};
-            sprintf(buffer, "%.17g", val.GetNumber());
-            m_res += buffer;
-        }
-        break;
-        case JsonType::String:
-            StringifyString(val.GetString()); // 生成字符串
-            break;
-        // 生成数组：只要输出"[]"，中间对逐个子值递归调用 stringify_value()
-        case JsonType::Array:
-            m_res += '[';
-            for (size_t i = 0; i < val.GetArraySize(); i++)
+            if (i != begin)
+                result += ',';
+            if (isArray)
+                StringifyValue(container.GetArrayElement(i));
+            else
             {
-                if (i > 0)
-                    m_res += ',';
-                StringifyValue(val.GetArrayElement(i));
+                StringifyString(container.GetObjectKey(i));
+                result += ':';
+                StringifyValue(container.GetObjectValue(i));
             }
-            m_res += ']';
-            break;
-        // 生成对象
-        case JsonType::Object:
-            m_res += '{';
-            for (int i = 0; i < val.GetObjectSize(); ++i)
-            {
-                if (i > 0)
-                    m_res += ',';
-                // 对象需要多处理一个 key 和冒号
-                StringifyString(val.GetObjectKey(i));
-                m_res += ':';
-                // 递归调用生成 json 值
-                StringifyValue(val.GetObjectValue(i));
-            }
-            m_res += '}';
-            break;
-        default:
-            assert(0 && "invalid type");
         }
     }
-    void JsonGenerator::StringifyString(const std::string &str)
+
+    const JsonProfile &JsonGenerator::GetLastStringifyProfile() const noexcept
     {
-        m_res += '\"';
-        for (auto it = str.begin(); it != str.end(); it++)
+        return m_profile;
+    }
+
+    /* 生成json的值 */
+    void JsonGenerator::StringifyValue(const JsonValue &root)
+    {
+        std::string &res = *m_res;
+        const JsonValue *val = &root;
+        for (;;)
         {
-            unsigned char ch = *it;
-            switch (ch)
+            // 1、输出一个值；非空的数组或对象只输出左括号和第一个元素之前的部分，然后压入新的一层
+            switch (val->GetType())
+            {
+            case JsonType::Null:
             {
-            /* 添加这些转义字符 */
-            case '\"':
-                m_res += "\\\"";
+                SJSON_TRACE_SCOPE(m_profile, Literal, res);
+                res += "null";
                 break;
-            case '\\':
-                m_res += "\\\\";
+            }
+            case JsonType::True:
+            {
+                SJSON_TRACE_SCOPE(m_profile, Literal, res);
+                res += "true";
                 break;
-            case '\b':
-                m_res += "\\b";
+            }
+            case JsonType::False:
+            {
+                SJSON_TRACE_SCOPE(m_profile, Literal, res);
+                res += "false";
                 break;
-            case '\f':
-                m_res += "\\f";
+            }
+            case JsonType::Number:
+            {
+                SJSON_TRACE_SCOPE(m_profile, Number, res);
+                switch (val->GetNumberKind())
+                {
+                case JsonNumberKind::Int64:
+                    JsonFormat::AppendInt64(res, val->GetInt64());
+                    break;
+                case JsonNumberKind::Uint64:
+                    JsonFormat::AppendUint64(res, val->GetUint64());
+                    break;
+                default:
+                {
+                    // 延迟转换的数字原样输出原文，不经过转换和格式化
+                    std::string_view text = val->GetNumberText();
+                    if (!text.empty())
+                        res.append(text.data(), text.size());
+                    else
+                        JsonFormat::AppendNumber(res, val->GetNumber());
+                    break;
+                }
+                }
                 break;
-            case '\n':
-                m_res += "\\n";
+            }
+            case JsonType::String:
+                StringifyString(val->GetString()); // 生成字符串
                 break;
-            case '\r':
-                m_res += "\\r";
+            // 生成数组：输出"["，然后转去输出第一个元素
+            case JsonType::Array:
+                res += '[';
+                if (val->GetArraySize() > 0)
+                {
+                    m_frames.push_back(Frame{val, 0});
+                    val = &val->GetArrayElement(0);
+                    continue;
+                }
+                res += ']';
                 break;
-            case '\t':
-                m_res += "\\t";
+            // 生成对象：对象需要多处理一个 key 和冒号
+            case JsonType::Object:
+                res += '{';
+                if (val->GetObjectSize() > 0)
+                {
+                    m_frames.push_back(Frame{val, 0});
+                    StringifyString(val->GetObjectKey(0));
+                    res += ':';
+                    val = &val->GetObjectValue(0);
+                    continue;
+                }
+                res += '}';
                 break;
             default:
-                // 低于 0x20 的字符需要转义为 \u00xx 的形式
-                if (ch < 0x20)
+                assert(0 && "invalid type");
+            }
+
+            // 2、一个完整的值已经输出，回到外层容器：还有下一个元素就输出逗号，否则输出右括号并继续弹出
+            for (;;)
+            {
+                if (m_frames.empty())
+                    return;
+                Frame &f = m_frames.back();
+                const JsonValue &c = *f.container;
+                ++f.index;
+                if (c.GetType() == JsonType::Array)
                 {
-                    char buffer[7] = {0};
-                    sprintf(buffer, "\\u%04X", ch);
-                    m_res += buffer;
+                    if (f.index < c.GetArraySize())
+                    {
+                        res += ',';
+                        val = &c.GetArrayElement(f.index);
+                        break;
+                    }
+                    res += ']';
                 }
                 else
-                    m_res += *it;
+                {
+                    if (f.index < c.GetObjectSize())
+                    {
+                        res += ',';
+                        StringifyString(c.GetObjectKey(f.index));
+                        res += ':';
+                        val = &c.GetObjectValue(f.index);
+                        break;
+                    }
+                    res += '}';
+                }
+                m_frames.pop_back();
             }
         }
-        m_res += '\"'; // 添加最后一个双引号
+    }
+    void JsonGenerator::StringifyString(const std::string &str)
+    {
+        SJSON_TRACE_SCOPE(m_profile, String, *m_res);
+        if (m_ascii)
+            JsonFormat::AppendAsciiString(*m_res, str);
+        else
+            JsonFormat::AppendString(*m_res, str);
+    }
+    void JsonGenerator::SetAsciiOutput(bool ascii) noexcept
+    {
+        m_ascii = ascii;
     }
 }
\ No newline at end of file
@@ -1,17 +1,41 @@
 #ifndef JSONGENERATOR_H
 #define JSONGENERATOR_H
 #include "JsonValue.h"
+#include "JsonTrace.h"
 namespace SJson
 {
     class JsonGenerator
     {
     public:
+        JsonGenerator() noexcept {}
+        /* 一次性生成 */
         JsonGenerator(const JsonValue &val, std::string &result);
+        /* 可复用：栈在多次生成之间保留容量 */
+        void Stringify(const JsonValue &val, std::string &result);
+        void Stringify(const Json &json, std::string &result);
+        /* 把 json 追加到 result 末尾，不清空 result */
+        void AppendValue(const Json &json, std::string &result);
+        /* 把数组或对象中 [begin, end) 的元素追加到 result，元素之间用逗号分隔，对象带上 key；不输出括号 */
+        void AppendElements(const JsonValue &container, size_t begin, size_t end, std::string &result);
+        /* 只输出 7 位 ascii，非 ascii 字符写成 \uXXXX；默认关闭，utf-8 原样输出 */
+        void SetAsciiOutput(bool ascii) noexcept;
+        /* 最近一次生成的分阶段统计，编译时定义 SJSON_TRACE 才有数据 */
+        const JsonProfile &GetLastStringifyProfile() const noexcept;
 
     private:
+        /* 生成 json 值：不递归，嵌套的数组和对象记录在 m_frames 中 */
         void StringifyValue(const JsonValue &val);
         void StringifyString(const std::string &str);
-        std::string &m_res;
+        /* 每一层尚未结束的数组或对象，以及下一个要输出的元素下标 */
+        struct Frame
+        {
+            const JsonValue *container;
+            size_t index;
+        };
+        std::vector<Frame> m_frames;
+        std::string *m_res = nullptr;
+        bool m_ascii = false;
+        JsonProfile m_profile;
     };
 }
 #endif // JSONGENERATOR_H
\ No newline at end of file
@@ -0,0 +1,490 @@
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include "JsonLexer.h"
+#include "JsonException.h"
+namespace SJson
+{
+    namespace JsonLexer
+    {
+        void ScanLiteral(const char *&cur, const char *literal)
+        {
+            assert(*cur == literal[0]);
+            size_t i;
+            for (i = 1; literal[i]; i++)
+            {                             // 直到 literal[i] 为 '\0'，循环结束
+                if (cur[i] != literal[i]) // 解析失败，抛出异常
+                    throw(JsonException("parse invalid value"));
+            }
+            // 解析成功，将 cur 右移 i 位
+            cur += i;
+        }
+        namespace
+        {
+            /* 校验数字的格式，返回数字之后的位置；integral 表示没有小数和指数部分 */
+            const char *ValidateNumber(const char *cur, bool &integral)
+            {
+                const char *p = cur;
+                // 处理负号
+                if (*p == '-')
+                    p++;
+
+                // 处理整数部分，分为两种合法情况：一种是单个 0，另一种是一个 1~9 再加上任意数量的 digit。
+                if (*p == '0')
+                    p++;
+                else
+                {
+                    if (!isdigit(*p))
+                        throw(JsonException("parse invalid value"));
+                    while (isdigit(*++p))
+                        ;
+                }
+                integral = true;
+
+                // 处理小数部分：小数点后面第一个数不是数字，则抛出异常，然后再处理连续的数字
+                if (*p == '.')
+                {
+                    integral = false;
+                    if (!isdigit(*++p))
+                        throw(JsonException("parse invalid value"));
+                    while (isdigit(*++p))
+                        ;
+                }
+
+                // 处理指数部分：需要处理指数的符号，符号之后的第一个字符不是数字，则抛出异常；然后再处理连续的数字
+                if (*p == 'e' || *p == 'E')
+                {
+                    integral = false;
+                    ++p;
+                    if (*p == '+' || *p == '-')
+                        ++p;
+                    if (!isdigit(*p))
+                        throw(JsonException("parse invalid value"));
+                    while (isdigit(*++p))
+                        ;
+                }
+                return p;
+            }
+
+            double ConvertDouble(const char *cur)
+            {
+                errno = 0;
+                // 将 json 的十进制数字转换为 double 型的二进制数字
+                double v = strtod(cur, NULL);
+                // 如果转换出来的数字过大，则抛出异常
+                if (errno == ERANGE && (v == HUGE_VAL || v == -HUGE_VAL))
+                    throw(JsonException("parse number too big"));
+                return v;
+            }
+
+            /* 把 [p, end) 的数字累加为 uint64，溢出时返回 false */
+            bool AccumulateDigits(const char *p, const char *end, uint64_t &u) noexcept
+            {
+                // 19 位以内的十进制数不会超过 uint64，只有第 20 位需要检查溢出
+                if (end - p > 20)
+                    return false;
+                u = 0;
+                for (; p != end; ++p)
+                {
+                    unsigned digit = *p - '0';
+                    if (u > (UINT64_MAX - digit) / 10)
+                        return false;
+                    u = u * 10 + digit;
+                }
+                return true;
+            }
+
+            /* [cur, end) 是校验过的整数，能用 int64、uint64 精确表示时填入 num 并返回 true */
+            bool ConvertInteger(const char *cur, const char *end, JsonNumber &num) noexcept
+            {
+                bool negative = *cur == '-';
+                uint64_t u;
+                // -0 保留为 double，否则会丢掉负号
+                if (!AccumulateDigits(cur + negative, end, u) || (negative && u == 0))
+                    return false;
+                if (!negative && u <= uint64_t(INT64_MAX))
+                {
+                    num.kind = JsonNumberKind::Int64;
+                    num.i = int64_t(u);
+                    return true;
+                }
+                if (!negative)
+                {
+                    num.kind = JsonNumberKind::Uint64;
+                    num.u = u;
+                    return true;
+                }
+                if (u <= uint64_t(INT64_MAX) + 1)
+                {
+                    num.kind = JsonNumberKind::Int64;
+                    num.i = u == uint64_t(INT64_MAX) + 1 ? INT64_MIN : -int64_t(u);
+                    return true;
+                }
+                return false;
+            }
+
+            /* [cur, end) 是校验过的数字，按十进制数量级判断：小于 1e308 的一定不会溢出 double，返回 false */
+            bool MayOverflow(const char *cur, const char *end) noexcept
+            {
+                const char *p = cur + (*cur == '-');
+                // 第一个非零数字的十进制指数
+                long long e10;
+                if (*p != '0')
+                {
+                    const char *q = p;
+                    while (q != end && isdigit(*q))
+                        ++q;
+                    e10 = (q - p) - 1;
+                    p = q;
+                }
+                else
+                {
+                    ++p;
+                    if (p == end || *p != '.')
+                        return false;
+                    const char *q = ++p;
+                    while (q != end && *q == '0')
+                        ++q;
+                    if (q == end || !isdigit(*q))
+                        return false; // 尾数为 0
+                    e10 = -(q - p) - 1;
+                    p = q;
+                }
+                while (p != end && *p != 'e' && *p != 'E')
+                    ++p;
+                if (p != end)
+                {
+                    ++p;
+                    bool negative = *p == '-';
+                    if (*p == '+' || *p == '-')
+                        ++p;
+                    long long e = 0;
+                    for (; p != end; ++p)
+                    {
+                        // 指数大到这个程度已经足以判断，不再累加，避免溢出
+                        if (e < 100000)
+                            e = e * 10 + (*p - '0');
+                    }
+                    e10 += negative ? -e : e;
+                }
+                return e10 >= 308;
+            }
+        }
+
+        double ScanNumber(const char *&cur)
+        {
+            bool integral;
+            const char *p = ValidateNumber(cur, integral);
+            double v = ConvertDouble(cur);
+            // 最后更新当前字符的位置
+            cur = p;
+            return v;
+        }
+        void ScanNumber(const char *&cur, JsonNumber &num)
+        {
+            bool integral;
+            const char *p = ValidateNumber(cur, integral);
+            if (integral && ConvertInteger(cur, p, num))
+            {
+                cur = p;
+                return;
+            }
+            num.kind = JsonNumberKind::Double;
+            num.d = ConvertDouble(cur);
+            cur = p;
+        }
+        void ScanNumberLazy(const char *&cur, JsonNumber &num)
+        {
+            bool integral;
+            const char *p = ValidateNumber(cur, integral);
+            if (integral && ConvertInteger(cur, p, num))
+            {
+                cur = p;
+                return;
+            }
+            // 只有可能溢出的数字才转换一次，保持与 ScanNumber 相同的 "parse number too big" 报错
+            num.kind = JsonNumberKind::Double;
+            if (MayOverflow(cur, p))
+                num.d = ConvertDouble(cur);
+            cur = p;
+        }
+        void SkipNumber(const char *&cur)
+        {
+            bool integral;
+            const char *p = ValidateNumber(cur, integral);
+            if (MayOverflow(cur, p))
+                ConvertDouble(cur);
+            cur = p;
+        }
+        void ScanString(const char *&cur, std::string &tmp)
+        {
+            ScanString(cur, tmp, SIZE_MAX);
+        }
+        bool ScanString(const char *&cur, std::string &tmp, size_t maxLength)
+        {
+            assert(*cur == '\"');
+            const char *p = cur + 1; // 跳过字符串的第一个引号
+            unsigned u = 0, u2 = 0;
+            // 每追加一个字符检查一次，超长的字符串不会被完整解码到缓冲区
+            const size_t limit = maxLength > SIZE_MAX - tmp.size() ? SIZE_MAX : tmp.size() + maxLength;
+            while (*p != '\"') // 直到解析到字符串结尾，也就是第二个引号
+            {
+                if (tmp.size() > limit)
+                {
+                    cur = p;
+                    return false;
+                }
+                // 字符串的结尾不是双引号，说明该字符串缺少引号，抛出异常即可
+                if (*p == '\0')
+                    throw(JsonException("parse miss quotation mark"));
+                // 处理 9 种转义字符：当前字符是'\'，然后跳到下一个字符
+                if (*p == '\\' && ++p)
+                {
+                    switch (*p++)
+                    {
+                    case '\"':
+                        tmp += '\"';
+                        break;
+                    case '\\':
+                        tmp += '\\';
+                        break;
+                    case '/':
+                        tmp += '/';
+                        break;
+                    case 'b':
+                        tmp += '\b';
+                        break;
+                    case 'f':
+                        tmp += '\f';
+                        break;
+                    case 'n':
+                        tmp += '\n';
+                        break;
+                    case 'r':
+                        tmp += '\r';
+                        break;
+                    case 't':
+                        tmp += '\t';
+                        break;
+                    case 'u':
+                        // 遇到\u转义时，调用parse_hex4()来解析4位十六进制数字
+                        ScanHex4(p, u);
+                        if (u >= 0xD800 && u <= 0xDBFF)
+                        {
+                            if (*p++ != '\\')
+                                throw(JsonException("parse invalid unicode surrogate"));
+                            if (*p++ != 'u')
+                                throw(JsonException("parse invalid unicode surrogate"));
+                            ScanHex4(p, u2);
+                            if (u2 < 0xDC00 || u2 > 0xDFFF)
+                                throw(JsonException("parse invalid unicode surrogate"));
+                            u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+                        }
+                        else if (u >= 0xDC00 && u <= 0xDFFF) // 没有高代理项在前的低代理项
+                            throw(JsonException("parse invalid unicode surrogate"));
+                        // 把码点编码成 utf-8，写进缓冲区
+                        EncodeUTF8(tmp, u);
+                        break;
+                    default:
+                        throw(JsonException("parse invalid string escape"));
+                    }
+                }
+                else if ((unsigned char)*p < 0x20)
+                {
+                    throw(JsonException("parse invalid string char"));
+                }
+                else
+                    tmp += *p++;
+            }
+            if (tmp.size() > limit)
+            {
+                cur = p;
+                return false;
+            }
+            // 更新当前字符串的位置
+            cur = ++p;
+            return true;
+        }
+        void SkipMemberKey(const char *&cur)
+        {
+            if (*cur != '\"')
+                throw(JsonException("parse miss key"));
+            try
+            {
+                SkipString(cur);
+            }
+            catch (const JsonException &)
+            {
+                throw(JsonException("parse miss key"));
+            }
+            SkipWhitespace(cur);
+            if (*cur++ != ':')
+                throw(JsonException("parse miss colon"));
+            SkipWhitespace(cur);
+        }
+        void SkipValue(const char *&cur, std::string &brackets)
+        {
+            // 与 JsonParser::ParseValue 相同的显式栈结构，只记录括号，不建立任何值
+            size_t bottom = brackets.size();
+            for (;;)
+            {
+                SkipWhitespace(cur);
+                switch (*cur)
+                {
+                case 'n':
+                    ScanLiteral(cur, "null");
+                    break;
+                case 't':
+                    ScanLiteral(cur, "true");
+                    break;
+                case 'f':
+                    ScanLiteral(cur, "false");
+                    break;
+                case '\"':
+                    SkipString(cur);
+                    break;
+                case '[':
+                    ++cur;
+                    SkipWhitespace(cur);
+                    if (*cur == ']')
+                    {
+                        ++cur;
+                        break;
+                    }
+                    brackets.push_back(']');
+                    continue;
+                case '{':
+                    ++cur;
+                    SkipWhitespace(cur);
+                    if (*cur == '}')
+                    {
+                        ++cur;
+                        break;
+                    }
+                    brackets.push_back('}');
+                    SkipMemberKey(cur);
+                    continue;
+                case '\0':
+                    throw(JsonException("parse expect value"));
+                default:
+                    SkipNumber(cur);
+                    break;
+                }
+
+                // 一个完整的值已经跳过，处理外层的逗号或右括号
+                for (;;)
+                {
+                    if (brackets.size() == bottom)
+                        return;
+                    char close = brackets.back();
+                    SkipWhitespace(cur);
+                    if (*cur == ',')
+                    {
+                        ++cur;
+                        SkipWhitespace(cur);
+                        if (close == '}')
+                            SkipMemberKey(cur);
+                        break;
+                    }
+                    if (*cur != close)
+                        throw(JsonException(close == ']' ? "parse miss comma or square bracket"
+                                                         : "parse miss comma or curly bracket"));
+                    ++cur;
+                    brackets.pop_back();
+                }
+            }
+        }
+        void SkipString(const char *&cur)
+        {
+            // 与 ScanString 做同样的校验，但不解码、不分配内存
+            assert(*cur == '\"');
+            const char *p = cur + 1;
+            unsigned u = 0, u2 = 0;
+            while (*p != '\"')
+            {
+                if (*p == '\0')
+                    throw(JsonException("parse miss quotation mark"));
+                if (*p == '\\' && ++p)
+                {
+                    switch (*p++)
+                    {
+                    case '\"':
+                    case '\\':
+                    case '/':
+                    case 'b':
+                    case 'f':
+                    case 'n':
+                    case 'r':
+                    case 't':
+                        break;
+                    case 'u':
+                        ScanHex4(p, u);
+                        if (u >= 0xD800 && u <= 0xDBFF)
+                        {
+                            if (*p++ != '\\')
+                                throw(JsonException("parse invalid unicode surrogate"));
+                            if (*p++ != 'u')
+                                throw(JsonException("parse invalid unicode surrogate"));
+                            ScanHex4(p, u2);
+                            if (u2 < 0xDC00 || u2 > 0xDFFF)
+                                throw(JsonException("parse invalid unicode surrogate"));
+                        }
+                        else if (u >= 0xDC00 && u <= 0xDFFF)
+                            throw(JsonException("parse invalid unicode surrogate"));
+                        break;
+                    default:
+                        throw(JsonException("parse invalid string escape"));
+                    }
+                }
+                else if ((unsigned char)*p < 0x20)
+                    throw(JsonException("parse invalid string char"));
+                else
+                    ++p;
+            }
+            cur = ++p;
+        }
+        void ScanHex4(const char *&p, unsigned &u)
+        {
+            u = 0;
+            for (size_t i = 0; i < 4; ++i)
+            {
+                char ch = *p++;
+                u <<= 4;
+                if (isdigit(ch))
+                    u |= ch - '0';
+                else if (ch >= 'A' && ch <= 'F')
+                    u |= ch - ('A' - 10);
+                else if (ch >= 'a' && ch <= 'f')
+                    u |= ch - ('a' - 10);
+                else
+                    throw(JsonException("parse invalid unicode hex"));
+            }
+        }
+        void EncodeUTF8(std::string &str, unsigned u)
+        {
+            if (u <= 0x7F)
+                str += static_cast<char>(u & 0xFF);
+            else if (u <= 0x7FF)
+            {
+                str += static_cast<char>(0xC0 | ((u >> 6) & 0xFF));
+                str += static_cast<char>(0x80 | (u & 0x3F));
+            }
+            else if (u <= 0xFFFF)
+            {
+                str += static_cast<char>(0xE0 | ((u >> 12) & 0xFF));
+                str += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+                str += static_cast<char>(0x80 | (u & 0x3F));
+            }
+            else
+            {
+                assert(u <= 0x10FFFF);
+                str += static_cast<char>(0xF0 | ((u >> 18) & 0xFF));
+                str += static_cast<char>(0x80 | ((u >> 12) & 0x3F));
+                str += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+                str += static_cast<char>(0x80 | (u & 0x3F));
+            }
+        }
+    }
+}
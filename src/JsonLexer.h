@@ -0,0 +1,53 @@
+#ifndef JSONLEXER_H
+#define JSONLEXER_H
+#include <cstdint>
+#include <string>
+#include "Json.h"
+
+namespace SJson
+{
+    /* 扫描出的数字，kind 为 JsonNumberKind，只有对应的字段有效 */
+    struct JsonNumber
+    {
+        int kind = JsonNumberKind::Double;
+        double d = 0;
+        int64_t i = 0;
+        uint64_t u = 0;
+    };
+
+    /* 词法层：JsonParser、JsonReader 共用的扫描函数，cur 指向当前字符，扫描成功后移动到下一个记号 */
+    namespace JsonLexer
+    {
+        /* 处理空白：空格符、制表符、换行符、回车符 */
+        inline void SkipWhitespace(const char *&cur) noexcept
+        {
+            while (*cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r')
+                ++cur;
+        }
+        /* 解析 null、true、false */
+        void ScanLiteral(const char *&cur, const char *literal);
+        /* 解析数字 */
+        double ScanNumber(const char *&cur);
+        /* 解析数字：没有小数、指数且在 int64、uint64 范围内的整数直接累加各位，不经过 strtod */
+        void ScanNumber(const char *&cur, JsonNumber &num);
+        /* 同上，但非整数不转换：只校验格式并排除溢出，num.d 不填写，由调用者保留原文 */
+        void ScanNumberLazy(const char *&cur, JsonNumber &num);
+        /* 只校验并跳过数字，不转换；只有可能溢出的数字才转换一次，保持 "parse number too big" 报错 */
+        void SkipNumber(const char *&cur);
+        /* 解析字符串，cur 指向第一个引号，解码后追加到 tmp */
+        void ScanString(const char *&cur, std::string &tmp);
+        /* 同上，但解码出的字节数超过 maxLength 时立即停止并返回 false，cur 停在超出的位置，不再继续解码 */
+        bool ScanString(const char *&cur, std::string &tmp, size_t maxLength);
+        /* 只校验并跳过字符串，不分配内存 */
+        void SkipString(const char *&cur);
+        /* 校验并跳过对象成员的 key 和冒号，以及冒号之后的空白 */
+        void SkipMemberKey(const char *&cur);
+        /* 校验并跳过一个完整的值（不递归），brackets 记录尚未闭合的括号，可在多次调用之间复用容量 */
+        void SkipValue(const char *&cur, std::string &brackets);
+        /* 解析Hex */
+        void ScanHex4(const char *&p, unsigned &u);
+        /* 把码点编码成 utf-8 */
+        void EncodeUTF8(std::string &str, unsigned u);
+    }
+}
+#endif // JSONLEXER_H
@@ -0,0 +1,307 @@
+#include <errno.h>
+#include <algorithm>
+#include <chrono>
+#include "JsonLinesWriter.h"
+#include "JsonGenerator.h"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace SJson
+{
+    struct JsonLinesWriter::Batch
+    {
+        std::string data;
+        uint64_t lines = 0;
+        Batch *next = nullptr;
+    };
+
+    struct JsonLinesWriter::ThreadBuffer
+    {
+        /* 只有所属线程和 Flush 会访问，平时没有竞争 */
+        std::mutex mutex;
+        Batch *batch = nullptr;
+        JsonGenerator generator;
+    };
+
+    namespace
+    {
+        std::atomic<uint64_t> g_nextWriterId{1};
+    }
+
+    JsonLinesWriter::JsonLinesWriter(int fd) : JsonLinesWriter(fd, Options()) {}
+
+    JsonLinesWriter::JsonLinesWriter(int fd, const Options &options)
+        : m_fd(fd), m_options(options), m_id(g_nextWriterId.fetch_add(1, std::memory_order_relaxed))
+    {
+        m_flusher = std::thread(&JsonLinesWriter::FlusherLoop, this);
+    }
+
+    JsonLinesWriter::~JsonLinesWriter() noexcept
+    {
+        Flush();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_flusher.join();
+        for (auto &buffer : m_buffers)
+            delete buffer->batch;
+        for (Batch *b : m_free)
+            delete b;
+    }
+
+    JsonLinesWriter::ThreadBuffer &JsonLinesWriter::LocalBuffer()
+    {
+        // 每个线程记住自己在各个 JsonLinesWriter 中的缓冲区，id 不会复用，因此已析构的 writer 留下的项不会被误用
+        thread_local std::vector<std::pair<uint64_t, ThreadBuffer *>> local;
+        for (auto &entry : local)
+        {
+            if (entry.first == m_id)
+                return *entry.second;
+        }
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->batch = TakeBatch();
+        ThreadBuffer *p = buffer.get();
+        {
+            std::lock_guard<std::mutex> lock(m_buffersMutex);
+            m_buffers.push_back(std::move(buffer));
+        }
+        local.emplace_back(m_id, p);
+        return *p;
+    }
+
+    void JsonLinesWriter::Append(const Json &json)
+    {
+        ThreadBuffer &buffer = LocalBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        Batch *b = buffer.batch;
+        buffer.generator.AppendValue(json, b->data);
+        b->data += '\n';
+        ++b->lines;
+        if (b->data.size() >= m_options.bufferSize)
+            Submit(buffer, ByAppend);
+    }
+
+    void JsonLinesWriter::Append(std::string_view line)
+    {
+        ThreadBuffer &buffer = LocalBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        Batch *b = buffer.batch;
+        b->data.append(line.data(), line.size());
+        b->data += '\n';
+        ++b->lines;
+        if (b->data.size() >= m_options.bufferSize)
+            Submit(buffer, ByAppend);
+    }
+
+    void JsonLinesWriter::Submit(ThreadBuffer &buffer, Submitter by)
+    {
+        Batch *b = buffer.batch;
+        if (by != ByFlusher && m_pending.load(std::memory_order_acquire) >= m_options.maxPendingBuffers)
+        {
+            // 只有追加时才丢弃，Flush 与析构要写出调用之前的所有行
+            if (by == ByAppend && m_options.dropWhenFull)
+            {
+                m_dropped.fetch_add(b->lines, std::memory_order_relaxed);
+                b->data.clear();
+                b->lines = 0;
+                return;
+            }
+            // 背压：等待后台线程写出；后台线程只 try_lock 线程缓冲区，这里持有缓冲区的锁等待不会死锁
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.notify_one();
+            m_drained.wait(lock, [this]
+                           { return m_pending.load(std::memory_order_acquire) < m_options.maxPendingBuffers; });
+        }
+        buffer.batch = TakeBatch();
+        m_pending.fetch_add(1, std::memory_order_acq_rel);
+        m_submitted.fetch_add(1, std::memory_order_acq_rel);
+        b->next = m_queue.load(std::memory_order_relaxed);
+        while (!m_queue.compare_exchange_weak(b->next, b, std::memory_order_seq_cst, std::memory_order_relaxed))
+            ;
+        // 与 FlusherLoop 中先设置 m_sleeping 再检查队列的顺序相对，不会丢失唤醒
+        if (m_sleeping.load(std::memory_order_seq_cst))
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wake.notify_one();
+        }
+    }
+
+    JsonLinesWriter::Batch *JsonLinesWriter::TakeBatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_freeMutex);
+            if (!m_free.empty())
+            {
+                Batch *b = m_free.back();
+                m_free.pop_back();
+                return b;
+            }
+        }
+        Batch *b = new Batch;
+        b->data.reserve(m_options.bufferSize + m_options.bufferSize / 4);
+        return b;
+    }
+
+    void JsonLinesWriter::CollectPartial(Submitter by)
+    {
+        std::vector<ThreadBuffer *> buffers;
+        {
+            std::lock_guard<std::mutex> lock(m_buffersMutex);
+            for (auto &buffer : m_buffers)
+                buffers.push_back(buffer.get());
+        }
+        for (ThreadBuffer *buffer : buffers)
+        {
+            // 后台线程不等待正在追加的线程，下一轮再取
+            std::unique_lock<std::mutex> lock(buffer->mutex, std::defer_lock);
+            if (by == ByFlusher)
+            {
+                if (!lock.try_lock())
+                    continue;
+            }
+            else
+                lock.lock();
+            if (!buffer->batch->data.empty())
+                Submit(*buffer, by);
+        }
+    }
+
+    void JsonLinesWriter::Flush()
+    {
+        CollectPartial(ByFlush);
+        uint64_t target = m_submitted.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.notify_one();
+        m_drained.wait(lock, [&]
+                       { return m_written >= target; });
+    }
+
+    void JsonLinesWriter::FlusherLoop() noexcept
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto interval = std::chrono::milliseconds(m_options.flushIntervalMs);
+        auto lastCollect = Clock::now();
+        std::vector<Batch *> batches;
+        for (;;)
+        {
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_sleeping.store(true, std::memory_order_seq_cst);
+                if (!m_stop && m_queue.load(std::memory_order_seq_cst) == nullptr)
+                {
+                    if (m_options.flushIntervalMs != 0)
+                        m_wake.wait_until(lock, lastCollect + interval);
+                    else
+                        m_wake.wait(lock);
+                }
+                m_sleeping.store(false, std::memory_order_relaxed);
+                stop = m_stop;
+            }
+            if (m_options.flushIntervalMs != 0 && Clock::now() - lastCollect >= interval)
+            {
+                CollectPartial(ByFlusher);
+                lastCollect = Clock::now();
+            }
+
+            // 整体取走已满的缓冲区，栈中是倒序，反转后按提交顺序写出
+            batches.clear();
+            for (Batch *b = m_queue.exchange(nullptr, std::memory_order_acquire); b != nullptr; b = b->next)
+                batches.push_back(b);
+            if (batches.empty())
+            {
+                if (stop)
+                    break;
+                continue;
+            }
+            std::reverse(batches.begin(), batches.end());
+            WriteBatches(batches);
+            {
+                std::lock_guard<std::mutex> lock(m_freeMutex);
+                for (Batch *b : batches)
+                {
+                    b->data.clear();
+                    b->lines = 0;
+                    m_free.push_back(b);
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending.fetch_sub(batches.size(), std::memory_order_acq_rel);
+                m_written += batches.size();
+            }
+            m_drained.notify_all();
+        }
+    }
+
+    void JsonLinesWriter::WriteBatches(std::vector<Batch *> &batches) noexcept
+    {
+        if (m_error.load(std::memory_order_relaxed) != 0)
+            return;
+#ifdef _WIN32
+        for (Batch *b : batches)
+        {
+            const char *p = b->data.data();
+            size_t left = b->data.size();
+            while (left > 0)
+            {
+                int n = _write(m_fd, p, static_cast<unsigned>(std::min<size_t>(left, 1u << 30)));
+                if (n < 0)
+                {
+                    m_error.store(errno, std::memory_order_relaxed);
+                    return;
+                }
+                p += n;
+                left -= n;
+            }
+        }
+#else
+        // 一次 writev 写出所有缓冲区，部分写入时跳过已写的部分继续
+        std::vector<iovec> iov;
+        iov.reserve(batches.size());
+        for (Batch *b : batches)
+        {
+            if (!b->data.empty())
+                iov.push_back(iovec{const_cast<char *>(b->data.data()), b->data.size()});
+        }
+        size_t first = 0;
+        while (first < iov.size())
+        {
+            int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+            ssize_t n = writev(m_fd, iov.data() + first, count);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                m_error.store(errno, std::memory_order_relaxed);
+                return;
+            }
+            size_t done = static_cast<size_t>(n);
+            while (first < iov.size() && done >= iov[first].iov_len)
+                done -= iov[first++].iov_len;
+            if (first < iov.size())
+            {
+                iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + done;
+                iov[first].iov_len -= done;
+            }
+        }
+#endif
+    }
+
+    uint64_t JsonLinesWriter::GetDroppedLines() const noexcept
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    int JsonLinesWriter::GetWriteError() const noexcept
+    {
+        return m_error.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef JSONLINESWRITER_H
+#define JSONLINESWRITER_H
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Json.h"
+
+namespace SJson
+{
+    /*
+     * 异步写出 JSON Lines（每行一个 json，以 '\n' 结尾）：
+     *   每个调用线程把行直接生成到自己的缓冲区（复用 JsonGenerator，不为每行构造字符串），缓冲区满后交给后台线程；
+     *   交接通过无锁栈完成，后台线程一次取走全部已满的缓冲区，按提交顺序用一次 writev 写出，写完的缓冲区回收复用。
+     * 同一线程写出的行保持顺序；不同线程之间的行以缓冲区为单位交错。
+     * 未满的缓冲区由后台线程按 flushInterval 定期取走，或者在 Flush、析构时写出。
+     */
+    class JsonLinesWriter
+    {
+    public:
+        struct Options
+        {
+            /* 每个线程缓冲区的大小，超过后提交给后台线程 */
+            size_t bufferSize = 64 * 1024;
+            /* 等待写出的缓冲区上限，达到上限后按 dropWhenFull 处理 */
+            size_t maxPendingBuffers = 64;
+            /* false：提交的线程等待后台线程写出（背压）；true：丢弃这个缓冲区中的行并计数 */
+            bool dropWhenFull = false;
+            /* 后台线程定期写出未满缓冲区的间隔，毫秒；0 表示只在缓冲区满、Flush、析构时写出 */
+            unsigned flushIntervalMs = 100;
+        };
+
+        /* 写入文件描述符 fd，不接管 fd 的所有权 */
+        explicit JsonLinesWriter(int fd);
+        JsonLinesWriter(int fd, const Options &options);
+        /* 写出所有剩余的行，然后停止后台线程 */
+        ~JsonLinesWriter() noexcept;
+        JsonLinesWriter(const JsonLinesWriter &) = delete;
+        JsonLinesWriter &operator=(const JsonLinesWriter &) = delete;
+
+        /* 追加一行，可在多个线程中同时调用 */
+        void Append(const Json &json);
+        /* 追加一行已经生成好的 json 文本，line 不含换行符 */
+        void Append(std::string_view line);
+        /* 写出调用之前追加的所有行后返回 */
+        void Flush();
+
+        /* 因队列已满被丢弃的行数 */
+        uint64_t GetDroppedLines() const noexcept;
+        /* 第一次写失败时的 errno，0 表示没有出错；出错后的行被丢弃 */
+        int GetWriteError() const noexcept;
+
+    private:
+        struct Batch;
+        struct ThreadBuffer;
+        /* 提交缓冲区的调用者：Append 在队列已满时按 dropWhenFull 处理；Flush（含析构）一定写出，队列满时等待；
+           后台线程不受队列上限限制，也不等待正在追加的线程 */
+        enum Submitter
+        {
+            ByAppend,
+            ByFlush,
+            ByFlusher
+        };
+        ThreadBuffer &LocalBuffer();
+        /* 把线程缓冲区中的内容交给后台线程，调用时持有 buffer 的锁 */
+        void Submit(ThreadBuffer &buffer, Submitter by);
+        Batch *TakeBatch();
+        void FlusherLoop() noexcept;
+        /* 写出一批缓冲区（按提交顺序） */
+        void WriteBatches(std::vector<Batch *> &batches) noexcept;
+        /* 取走所有线程中未满的缓冲区；后台线程调用时跳过正在追加的缓冲区 */
+        void CollectPartial(Submitter by);
+
+        const int m_fd;
+        const Options m_options;
+        const uint64_t m_id;
+
+        /* 各线程的缓冲区，只在线程第一次写入时加锁注册 */
+        std::mutex m_buffersMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+
+        /* 已满待写出的缓冲区：无锁栈，后台线程整体取走后反转为提交顺序 */
+        std::atomic<Batch *> m_queue{nullptr};
+        std::atomic<size_t> m_pending{0};
+        /* 回收的缓冲区 */
+        std::mutex m_freeMutex;
+        std::vector<Batch *> m_free;
+
+        /* 后台线程的休眠与唤醒、背压等待、Flush 等待 */
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_drained;
+        std::atomic<bool> m_sleeping{false};
+        bool m_stop = false;
+        /* 提交、写出的缓冲区序号，Flush 等待写出追上提交 */
+        std::atomic<uint64_t> m_submitted{0};
+        uint64_t m_written = 0;
+
+        std::atomic<uint64_t> m_dropped{0};
+        std::atomic<int> m_error{0};
+        std::thread m_flusher;
+    };
+}
+#endif // JSONLINESWRITER_H
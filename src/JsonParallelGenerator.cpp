@@ -0,0 +1,203 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "JsonParallelGenerator.h"
+#include "JsonFormat.h"
+#include "JsonGenerator.h"
+namespace SJson
+{
+    JsonParallelGenerator::JsonParallelGenerator(size_t threads) noexcept
+        : m_threads(threads != 0 ? threads : std::thread::hardware_concurrency())
+    {
+        if (m_threads == 0)
+            m_threads = 1;
+    }
+
+    void JsonParallelGenerator::SetChunkSize(size_t elements) noexcept
+    {
+        m_chunk = elements != 0 ? elements : 1;
+    }
+
+    std::string &JsonParallelGenerator::Literal()
+    {
+        // 相邻的固定文本合并为一段
+        if (m_pieces.empty() || m_pieces.back().container != nullptr)
+            m_pieces.emplace_back();
+        return m_pieces.back().text;
+    }
+
+    void JsonParallelGenerator::AppendLiteral(const char *text)
+    {
+        Literal() += text;
+    }
+
+    void JsonParallelGenerator::Plan(const JsonValue &val)
+    {
+        bool isArray = val.GetType() == JsonType::Array;
+        size_t n = isArray ? val.GetArraySize() : val.GetObjectSize();
+        AppendLiteral(isArray ? "[" : "{");
+        // 连续的小元素按 m_chunk 个一块；遇到大容器时先结束当前块，再递归切分大容器
+        size_t run = 0;
+        auto flush = [&](size_t end)
+        {
+            for (size_t b = run; b < end; b += m_chunk)
+            {
+                if (b != 0)
+                    AppendLiteral(",");
+                Piece piece;
+                piece.container = &val;
+                piece.begin = b;
+                piece.end = end - b > m_chunk ? b + m_chunk : end;
+                m_jobs.push_back(m_pieces.size());
+                m_pieces.push_back(std::move(piece));
+            }
+        };
+        for (size_t i = 0; i < n; ++i)
+        {
+            const JsonValue &child = isArray ? val.GetArrayElement(i) : val.GetObjectValue(i);
+            int t = child.GetType();
+            size_t size = t == JsonType::Array ? child.GetArraySize() : t == JsonType::Object ? child.GetObjectSize() : 0;
+            if (size < m_chunk)
+                continue;
+            flush(i);
+            if (i != 0)
+                AppendLiteral(",");
+            if (!isArray)
+            {
+                JsonFormat::AppendString(Literal(), val.GetObjectKey(i));
+                AppendLiteral(":");
+            }
+            Plan(child);
+            run = i + 1;
+        }
+        flush(n);
+        AppendLiteral(isArray ? "]" : "}");
+    }
+
+    void JsonParallelGenerator::Generate(size_t workers, const std::function<void(size_t)> &done, const std::function<bool(size_t)> &admit)
+    {
+        std::atomic<size_t> next{0};
+        auto work = [&]
+        {
+            JsonGenerator generator;
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < m_jobs.size();)
+            {
+                if (admit && !admit(i))
+                    return;
+                Piece &piece = m_pieces[m_jobs[i]];
+                generator.AppendElements(*piece.container, piece.begin, piece.end, piece.text);
+                done(m_jobs[i]);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < workers && i < m_jobs.size(); ++i)
+            threads.emplace_back(work);
+        if (workers != 0)
+            work();
+        for (auto &t : threads)
+            t.join();
+    }
+
+    void JsonParallelGenerator::Stringify(const Json &json, std::string &result)
+    {
+        const JsonValue &root = json.Value();
+        int t = root.GetType();
+        size_t size = t == JsonType::Array ? root.GetArraySize() : t == JsonType::Object ? root.GetObjectSize() : 0;
+        m_pieces.clear();
+        m_jobs.clear();
+        if (m_threads == 1 || size < m_chunk)
+        {
+            JsonGenerator().Stringify(root, result);
+            return;
+        }
+        Plan(root);
+        Generate(m_threads, [](size_t) {});
+        size_t total = 0;
+        for (const auto &piece : m_pieces)
+            total += piece.text.size();
+        result.clear();
+        result.reserve(total);
+        for (auto &piece : m_pieces)
+            result += piece.text;
+        m_pieces.clear();
+    }
+
+    void JsonParallelGenerator::Stringify(const Json &json, const std::function<void(const char *data, size_t size)> &sink)
+    {
+        const JsonValue &root = json.Value();
+        int t = root.GetType();
+        size_t size = t == JsonType::Array ? root.GetArraySize() : t == JsonType::Object ? root.GetObjectSize() : 0;
+        m_pieces.clear();
+        m_jobs.clear();
+        if (m_threads == 1 || size < m_chunk)
+        {
+            std::string result;
+            JsonGenerator().Stringify(root, result);
+            sink(result.data(), result.size());
+            return;
+        }
+        Plan(root);
+        // 调用线程负责按顺序写出，生成交给 m_threads 个后台线程
+        // 块按 m_jobs 的顺序领取，第 job 块要等写出的块数进入窗口才开始生成，已生成未写出的块不超过 window 个
+        const size_t window = 2 * m_threads;
+        std::mutex mutex;
+        std::condition_variable ready, room;
+        std::vector<char> finished(m_pieces.size(), 0);
+        for (size_t i = 0; i < m_pieces.size(); ++i)
+            finished[i] = m_pieces[i].container == nullptr;
+        size_t written = 0;
+        bool cancelled = false;
+        std::thread producer([&]
+                             { Generate(
+                                   m_threads, [&](size_t index)
+                                   {
+                                       {
+                                           std::lock_guard<std::mutex> lock(mutex);
+                                           finished[index] = 1;
+                                       }
+                                       ready.notify_one(); },
+                                   [&](size_t job)
+                                   {
+                                       std::unique_lock<std::mutex> lock(mutex);
+                                       room.wait(lock, [&]
+                                                 { return cancelled || job < written + window; });
+                                       return !cancelled; }); });
+        try
+        {
+            for (size_t i = 0; i < m_pieces.size(); ++i)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&]
+                               { return finished[i] != 0; });
+                }
+                Piece &piece = m_pieces[i];
+                sink(piece.text.data(), piece.text.size());
+                std::string().swap(piece.text);
+                if (piece.container != nullptr)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ++written;
+                    }
+                    room.notify_all();
+                }
+            }
+        }
+        catch (...)
+        {
+            // sink 抛出异常时让等待窗口的线程停下，再等生成线程结束，它们仍在使用 m_pieces
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                cancelled = true;
+            }
+            room.notify_all();
+            producer.join();
+            m_pieces.clear();
+            throw;
+        }
+        producer.join();
+        m_pieces.clear();
+    }
+}
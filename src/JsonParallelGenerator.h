@@ -0,0 +1,49 @@
+#ifndef JSONPARALLELGENERATOR_H
+#define JSONPARALLELGENERATOR_H
+#include <functional>
+#include <string>
+#include <vector>
+#include "JsonValue.h"
+
+namespace SJson
+{
+    /*
+     * 并行生成：元素个数不少于分块大小的数组、对象（包括嵌套在其中的大容器）按元素区间切成若干块，
+     * 每块由一个线程用独立的 JsonGenerator 生成，再按顺序拼接或写入 sink。输出与 JsonGenerator 逐字节相同。
+     * 小于分块大小的文档直接串行生成。
+     */
+    class JsonParallelGenerator
+    {
+    public:
+        /* threads 为 0 时使用硬件线程数 */
+        explicit JsonParallelGenerator(size_t threads = 0) noexcept;
+        /* 每块的元素个数，默认 4096 */
+        void SetChunkSize(size_t elements) noexcept;
+
+        /* 各块生成后先求出总长度，一次分配后拼接 */
+        void Stringify(const Json &json, std::string &result);
+        /* 按顺序把各块写入 sink，写出的块立即释放；生成最多领先写出 2 倍线程数的块，暂存的输出不随文档增长 */
+        void Stringify(const Json &json, const std::function<void(const char *data, size_t size)> &sink);
+
+    private:
+        /* 一段输出：container 为空时是括号、逗号、key 等固定文本，否则是 container 中 [begin, end) 的元素 */
+        struct Piece
+        {
+            std::string text;
+            const JsonValue *container = nullptr;
+            size_t begin = 0;
+            size_t end = 0;
+        };
+        void Plan(const JsonValue &val);
+        void AppendLiteral(const char *text);
+        std::string &Literal();
+        /* 用 workers 个线程生成所有块，每完成一块调用 done(index)；admit 不为空时，生成第 job 块前先调用 admit(job)，返回 false 时该线程停止 */
+        void Generate(size_t workers, const std::function<void(size_t)> &done, const std::function<bool(size_t)> &admit = nullptr);
+
+        size_t m_threads;
+        size_t m_chunk = 4096;
+        std::vector<Piece> m_pieces;
+        std::vector<size_t> m_jobs;
+    };
+}
+#endif // JSONPARALLELGENERATOR_H
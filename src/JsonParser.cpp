@@ -1,367 +1,569 @@
 #include <assert.h>
-#include <ctype.h>
-#include <errno.h>
-#include <math.h>
-#include <stdlib.h>
+#include <iterator>
 #include "JsonParser.h"
+#include "JsonBatch.h"
+#include "JsonLexer.h"
 #include "JsonException.h"
+#include "JsonUtf8.h"
 namespace SJson
 {
-    inline void Expect(const char *&c, char ch)
+    JsonParser::JsonParser() noexcept {}
+    JsonParser::JsonParser(JsonValue &val, const std::string &content)
     {
-        assert(*c == ch);
-        ++c;
+        Parse(val, content);
     }
-    JsonParser::JsonParser(JsonValue &val, const std::string &content)
-        : m_val(val), m_cur(content.c_str())
-    {
-        m_val.SetType(JsonType::Null);
-        // 去掉Value前面的空白，若 json 在一个值之后，空白之后还有其他字符的话，说明该 json 值是不合法的。
-        ParseWhitespace();
-        ParseValue();
-        ParseWhitespace();
-        if (*m_cur != '\0')
+    JsonParser::~JsonParser() noexcept
+    {
+        ReleaseScratch();
+    }
+    void JsonParser::Parse(JsonValue &val, const std::string &content)
+    {
+        ParseDocument(val, content, nullptr);
+    }
+    void JsonParser::ParseDocument(JsonValue &val, const std::string &content, const JsonProjection::Node *root)
+    {
+        // 先回收旧文档，val 变为 null，解析失败时也保持为 null
+        Recycle(val);
+        m_cur = content.c_str();
+        m_reused = 0;
+        m_node = root != nullptr && !root->leaf ? root : nullptr;
+        SJSON_TRACE_RESET(m_profile);
+        SJSON_TRACE_SCOPE(m_profile, Total, m_cur);
+        m_errorOffset = 0;
+        m_bytes = 0;
+        m_nodes = 0;
+        try
+        {
+            if (m_validateUtf8)
+            {
+                // 合法的 json 中大于 0x7F 的字节只会出现在字符串里，校验整个输入等价于校验所有字符串，而且可以整段向量化
+                size_t offset = JsonUtf8::Validate(content.data(), content.size());
+                if (offset != content.size())
+                {
+                    m_cur = content.c_str() + offset;
+                    throw(JsonException("parse invalid utf8"));
+                }
+            }
+            // 去掉Value前面的空白，若 json 在一个值之后，空白之后还有其他字符的话，说明该 json 值是不合法的。
+            ParseWhitespace();
+            ParseValue();
+            ParseWhitespace();
+            if (*m_cur != '\0')
+                throw(JsonException("parse root not singular"));
+        }
+        catch (...)
         {
+            m_errorOffset = m_cur - content.c_str();
             m_val.SetType(JsonType::Null);
-            throw(JsonException("parse root not singular"));
+            m_values.clear();
+            m_frames.clear();
+            m_keyTop = 0;
+            m_brackets.clear();
+            throw;
+        }
+        val = std::move(m_val);
+        if (m_stats != nullptr)
+        {
+            *m_stats = JsonStats();
+            val.CollectStats(*m_stats);
+            m_stats->reusedBlocks = m_reused;
         }
     }
-    void JsonParser::ParseWhitespace() noexcept
+    void JsonParser::Parse(Json &json, const std::string &content)
     {
-        /* 过滤掉 json 字符串中的空白，即空格符、制表符、换行符、回车符 */
-        while (*m_cur == ' ' || *m_cur == '\t' || *m_cur == '\n' || *m_cur == '\r')
-            ++m_cur;
+        Parse(json.Value(), content);
     }
-    void JsonParser::ParseValue()
+    void JsonParser::Parse(Json &json, const std::string &content, std::string &status) noexcept
     {
-        switch (*m_cur)
+        try
         {
-        case 'n':
-            ParseLiteral("null", JsonType::Null);
-            return;
-        case 't':
-            ParseLiteral("true", JsonType::True);
-            return;
-        case 'f':
-            ParseLiteral("false", JsonType::False);
-            return;
-        case '\"':
-            ParseString();
-            return;
-        case '[':
-            ParseArray();
-            return;
-        case '{':
-            ParseObject();
-            return;
-        case '\0':
-            throw(JsonException("parse expect value"));
-        default:
-            ParseNumber();
-            return;
+            Parse(json, content);
+            status = "parse ok";
+        }
+        catch (const JsonException &msg)
+        {
+            status = msg.what();
+        }
+        catch (...)
+        {
+            // 内存不足等非解析错误：文档已被置为 null，不能留下上一次的状态；连状态都写不进时清空
+            try
+            {
+                status = JsonStatus::Message(JsonStatus::Unknown);
+            }
+            catch (...)
+            {
+                status.clear();
+            }
         }
     }
-    void JsonParser::ParseLiteral(const char *literal, JsonType::type t)
+    void JsonParser::Parse(Json &json, const std::string &content, const JsonProjection &projection)
     {
-        Expect(m_cur, literal[0]);
-        size_t i;
-        for (i = 0; literal[i + 1]; i++)
-        {                                   // 直到 literal[i+1] 为 '\0'，循环结束
-            if (m_cur[i] != literal[i + 1]) // 解析失败，抛出异常
-                throw(JsonException("parse invalid value"));
-        }
-        // 解析成功，将 m_cur 右移 i 位，然后设置 val_ 的类型为 t
-        m_cur += i;
-        m_val.SetType(t);
+        ParseDocument(json.Value(), content, &projection.GetRoot());
     }
-    void JsonParser::ParseNumber()
+    void JsonParser::Parse(Json &json, const std::string &content, const JsonProjection &projection, std::string &status) noexcept
     {
-        const char *p = m_cur;
-        // 处理负号
-        if (*p == '-')
-            p++;
-
-        // 处理整数部分，分为两种合法情况：一种是单个 0，另一种是一个 1~9 再加上任意数量的 digit。
-        if (*p == '0')
-            p++;
-        else
+        try
         {
-            if (!isdigit(*p))
-                throw(JsonException("parse invalid value"));
-            while (isdigit(*++p))
-                ;
+            Parse(json, content, projection);
+            status = "parse ok";
         }
-
-        // 处理小数部分：小数点后面第一个数不是数字，则抛出异常，然后再处理连续的数字
-        if (*p == '.')
+        catch (const JsonException &msg)
         {
-            if (!isdigit(*++p))
-                throw(JsonException("parse invalid value"));
-            while (isdigit(*++p))
-                ;
+            status = msg.what();
         }
-
-        // 处理指数部分：需要处理指数的符号，符号之后的第一个字符不是数字，则抛出异常；然后再处理连续的数字
-        if (*p == 'e' || *p == 'E')
+        catch (...)
         {
-            ++p;
-            if (*p == '+' || *p == '-')
-                ++p;
-            if (!isdigit(*p))
-                throw(JsonException("parse invalid value"));
-            while (isdigit(*++p))
-                ;
+            try
+            {
+                status = JsonStatus::Message(JsonStatus::Unknown);
+            }
+            catch (...)
+            {
+                status.clear();
+            }
         }
-
-        errno = 0;
-        // 将 json 的十进制数字转换为 double 型的二进制数字
-        double v = strtod(m_cur, NULL);
-        // 如果转换出来的数字过大，则抛出异常
-        if (errno == ERANGE && (v == HUGE_VAL || v == -HUGE_VAL))
-            throw(JsonException("parse number too big"));
-
-        // 最后设置 Value 为数字，然后更新 m_cur 的位置
-        m_val.SetNumber(v);
-        m_cur = p;
     }
-    void JsonParser::ParseString()
+    void JsonParser::SetMaxDepth(size_t depth) noexcept
+    {
+        m_maxDepth = depth;
+    }
+    void JsonParser::SetMaxBytes(size_t bytes) noexcept
     {
-        std::string s = "";
-        // 用临时值 s 来保存解析出来的字符串，然后将 s 赋值为 Value
-        ParseStringRaw(s);
-        m_val.SetString(s);
+        m_maxBytes = bytes;
+        m_limited = m_maxBytes != 0 || m_maxNodes != 0 || m_maxStringLength != 0 || m_maxContainerSize != 0;
     }
-    void JsonParser::ParseStringRaw(std::string &tmp)
+    void JsonParser::SetMaxNodes(size_t nodes) noexcept
     {
-        Expect(m_cur, '\"'); // 跳过字符串的第一个引号
-        const char *p = m_cur;
-        unsigned u = 0, u2 = 0;
-        while (*p != '\"') // 直到解析到字符串结尾，也就是第二个引号
+        m_maxNodes = nodes;
+        m_limited = m_maxBytes != 0 || m_maxNodes != 0 || m_maxStringLength != 0 || m_maxContainerSize != 0;
+    }
+    void JsonParser::SetMaxStringLength(size_t length) noexcept
+    {
+        m_maxStringLength = length;
+        m_limited = m_maxBytes != 0 || m_maxNodes != 0 || m_maxStringLength != 0 || m_maxContainerSize != 0;
+    }
+    void JsonParser::SetMaxContainerSize(size_t size) noexcept
+    {
+        m_maxContainerSize = size;
+        m_limited = m_maxBytes != 0 || m_maxNodes != 0 || m_maxStringLength != 0 || m_maxContainerSize != 0;
+    }
+    void JsonParser::Charge(size_t bytes)
+    {
+        m_bytes += bytes;
+        if (m_maxBytes != 0 && m_bytes > m_maxBytes)
+            throw(JsonException("parse limit exceeded"));
+    }
+    void JsonParser::SetValidateUtf8(bool validate) noexcept
+    {
+        m_validateUtf8 = validate;
+    }
+    void JsonParser::SetLazyNumbers(bool lazy) noexcept
+    {
+        m_lazyNumbers = lazy;
+    }
+    size_t JsonParser::GetErrorOffset() const noexcept
+    {
+        return m_errorOffset;
+    }
+    const JsonProfile &JsonParser::GetLastParseProfile() const noexcept
+    {
+        return m_profile;
+    }
+    void JsonParser::SetStats(JsonStats *stats) noexcept
+    {
+        m_stats = stats;
+    }
+    void JsonParser::ReleaseScratch() noexcept
+    {
+        for (auto p : m_freeStrings)
+            delete p;
+        for (auto p : m_freeArrays)
+            delete p;
+        for (auto p : m_freeObjects)
+            delete p;
+        std::vector<JsonShared<std::string> *>().swap(m_freeStrings);
+        std::vector<JsonShared<JsonArray> *>().swap(m_freeArrays);
+        std::vector<JsonShared<JsonObject> *>().swap(m_freeObjects);
+        std::string().swap(m_buffer);
+        std::vector<JsonValue>().swap(m_values);
+        std::vector<std::string>().swap(m_keys);
+        std::vector<Frame>().swap(m_frames);
+        m_keyTop = 0;
+    }
+    void JsonParser::Recycle(JsonValue &val) noexcept
+    {
+        // 只回收独占的负载，仍被其他 Json 共享的负载只释放引用；子节点移到 m_values 上逐个处理，不递归
+        size_t bottom = m_values.size();
+        m_values.push_back(std::move(val));
+        while (m_values.size() > bottom)
         {
-            // 字符串的结尾不是双引号，说明该字符串缺少引号，抛出异常即可
-            if (*p == '\0')
-                throw(JsonException("parse miss quotation mark"));
-            // 处理 9 种转义字符：当前字符是'\'，然后跳到下一个字符
-            if (*p == '\\' && ++p)
+            JsonValue v(std::move(m_values.back()));
+            m_values.pop_back();
+            switch (v.m_type)
             {
-                switch (*p++)
+            case JsonType::Number:
+                // 延迟转换的数字的原文负载与字符串共用回收池
+                if (v.m_numKind == JsonValue::TextShared && v.m_string->refs.load(std::memory_order_acquire) == 1)
                 {
-                case '\"':
-                    tmp += '\"';
-                    break;
-                case '\\':
-                    tmp += '\\';
-                    break;
-                case '/':
-                    tmp += '/';
-                    break;
-                case 'b':
-                    tmp += '\b';
-                    break;
-                case 'f':
-                    tmp += '\f';
-                    break;
-                case 'n':
-                    tmp += '\n';
-                    break;
-                case 'r':
-                    tmp += '\r';
-                    break;
-                case 't':
-                    tmp += '\t';
-                    break;
-                case 'u':
-                    // 遇到\u转义时，调用parse_hex4()来解析4位十六进制数字
-                    ParseHex4(p, u);
-                    if (u >= 0xD800 && u <= 0xDBFF)
-                    {
-                        if (*p++ != '\\')
-                            throw(JsonException("parse invalid unicode surrogate"));
-                        if (*p++ != 'u')
-                            throw(JsonException("parse invalid unicode surrogate"));
-                        ParseHex4(p, u2);
-                        if (u2 < 0xDC00 || u2 > 0xDFFF)
-                            throw(JsonException("parse invalid unicode surrogate"));
-                        u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
-                    }
-                    // 把码点编码成 utf-8，写进缓冲区
-                    ParseUTF8(tmp, u);
-                    break;
-                default:
-                    throw(JsonException("parse invalid string escape"));
+                    m_freeStrings.push_back(v.m_string);
+                    v.m_type = JsonType::Null;
                 }
+                break;
+            case JsonType::String:
+                if (v.m_string->refs.load(std::memory_order_acquire) == 1)
+                {
+                    m_freeStrings.push_back(v.m_string);
+                    v.m_type = JsonType::Null;
+                }
+                break;
+            case JsonType::Array:
+                if (v.m_array->refs.load(std::memory_order_acquire) == 1)
+                {
+                    for (auto &e : v.m_array->data)
+                        m_values.push_back(std::move(e));
+                    v.m_array->data.clear();
+                    m_freeArrays.push_back(v.m_array);
+                    v.m_type = JsonType::Null;
+                }
+                break;
+            case JsonType::Object:
+                if (v.m_object->refs.load(std::memory_order_acquire) == 1)
+                {
+                    // 保留 key 的容量，取出时再覆盖
+                    for (auto &m : v.m_object->data)
+                        m_values.push_back(std::move(m.second));
+                    m_freeObjects.push_back(v.m_object);
+                    v.m_type = JsonType::Null;
+                }
+                break;
+            default:
+                break;
             }
-            else if ((unsigned char)*p < 0x20)
-            {
-                throw(JsonException("parse invalid string char"));
-            }
-            else
-                tmp += *p++;
         }
-        // 更新当前字符串的位置
-        m_cur = ++p;
     }
-    void JsonParser::ParseHex4(const char *&p, unsigned &u)
+    JsonShared<std::string> *JsonParser::TakeString()
     {
-        u = 0;
-        for (size_t i = 0; i < 4; ++i)
+        if (m_freeStrings.empty())
         {
-            char ch = *p++;
-            u <<= 4;
-            if (isdigit(ch))
-                u |= ch - '0';
-            else if (ch >= 'A' && ch <= 'F')
-                u |= ch - ('A' - 10);
-            else if (ch >= 'a' && ch <= 'f')
-                u |= ch - ('a' - 10);
-            else
-                throw(JsonException("parse invalid unicode hex"));
+            SJSON_TRACE_SCOPE(m_profile, Allocation, sizeof(JsonShared<std::string>));
+            return new JsonShared<std::string>(std::string());
         }
+        auto p = m_freeStrings.back();
+        m_freeStrings.pop_back();
+        p->hash.store(0, std::memory_order_relaxed);
+        ++m_reused;
+        return p;
     }
-    void JsonParser::ParseUTF8(std::string &str, unsigned u)
+    JsonShared<JsonArray> *JsonParser::TakeArray()
     {
-        if (u <= 0x7F)
-            str += static_cast<char>(u & 0xFF);
-        else if (u <= 0x7FF)
+        if (m_freeArrays.empty())
         {
-            str += static_cast<char>(0xC0 | ((u >> 6) & 0xFF));
-            str += static_cast<char>(0x80 | (u & 0x3F));
+            SJSON_TRACE_SCOPE(m_profile, Allocation, sizeof(JsonShared<JsonArray>));
+            return new JsonShared<JsonArray>(JsonArray());
         }
-        else if (u <= 0xFFFF)
-        {
-            str += static_cast<char>(0xE0 | ((u >> 12) & 0xFF));
-            str += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
-            str += static_cast<char>(0x80 | (u & 0x3F));
-        }
-        else
+        auto p = m_freeArrays.back();
+        m_freeArrays.pop_back();
+        p->hash.store(0, std::memory_order_relaxed);
+        ++m_reused;
+        return p;
+    }
+    JsonShared<JsonObject> *JsonParser::TakeObject()
+    {
+        if (m_freeObjects.empty())
         {
-            assert(u <= 0x10FFFF);
-            str += static_cast<char>(0xF0 | ((u >> 18) & 0xFF));
-            str += static_cast<char>(0x80 | ((u >> 12) & 0x3F));
-            str += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
-            str += static_cast<char>(0x80 | (u & 0x3F));
+            SJSON_TRACE_SCOPE(m_profile, Allocation, sizeof(JsonShared<JsonObject>));
+            return new JsonShared<JsonObject>(JsonObject());
         }
+        auto p = m_freeObjects.back();
+        m_freeObjects.pop_back();
+        p->hash.store(0, std::memory_order_relaxed);
+        ++m_reused;
+        return p;
     }
-
-    void JsonParser::ParseArray()
+    void JsonParser::ParseWhitespace() noexcept
     {
-        Expect(m_cur, '['); // 处理数字的左括号，然后将当前字符的位置右移一位
-        ParseWhitespace();  // 第一个解析空白：在左括号之后解析空白
-        std::vector<JsonValue> tmp;
-        if (*m_cur == ']')
-        { // 遇到数组的右括号，然后将当前字符位置右移一位，并将 Value 设置为数组 tmp
-            ++m_cur;
-            m_val.SetArray(tmp);
-            return;
-        }
+        SJSON_TRACE_SCOPE(m_profile, Whitespace, m_cur);
+        JsonLexer::SkipWhitespace(m_cur);
+    }
+    void JsonParser::ParseValue()
+    {
+        // 用显式的栈 m_frames 代替递归：每一层记录一个尚未结束的数组或对象
+        size_t bottom = m_frames.size();
         for (;;)
         {
-            // 先解析 json 值，如解析出现异常，则将 Value 设置为 null，然后抛出异常
-            try
+            // 1、解析一个值的开头：标量直接解析到 m_val；遇到非空容器则压入新的一层，继续解析它的第一个元素
+            if (ParseValueStart())
+                continue;
+            // 2、此时 m_val 中是一个完整的值，把它压入外层容器的栈中，然后处理逗号或右括号
+            for (;;)
             {
-                ParseValue();
-            }
-            catch (JsonException)
-            {
-                m_val.SetType(JsonType::Null);
-                throw;
+                if (m_frames.size() == bottom)
+                    return;
+                const Frame &f = m_frames.back();
+                m_values.push_back(std::move(m_val));
+                if (m_limited && m_maxContainerSize != 0 && m_values.size() - f.base > m_maxContainerSize)
+                    throw(JsonException("parse limit exceeded"));
+                ParseWhitespace(); // 在逗号或右括号之前处理空白
+                if (*m_cur == ',')
+                {
+                    ++m_cur;
+                    ParseWhitespace(); // 在逗号之后处理空白
+                    if (f.type == JsonType::Array)
+                        m_node = f.node; // 投影作用于数组的每一个元素
+                    else if (!ParseMemberKey())
+                    {
+                        // 剩余的成员都被投影跳过，对象已经结束
+                        EndObject(f.base, f.keyBase);
+                        m_frames.pop_back();
+                        continue;
+                    }
+                    break;
+                }
+                if (f.type == JsonType::Array)
+                {
+                    if (*m_cur != ']')
+                        throw(JsonException("parse miss comma or square bracket"));
+                    ++m_cur;
+                    EndArray(f.base);
+                }
+                else
+                {
+                    if (*m_cur != '}')
+                        throw(JsonException("parse miss comma or curly bracket"));
+                    ++m_cur;
+                    EndObject(f.base, f.keyBase);
+                }
+                // 容器结束，它本身成为外层的一个完整的值
+                m_frames.pop_back();
             }
-            // 将解析出来的值加入到 tmp 后面
-            tmp.push_back(m_val);
-            ParseWhitespace(); // 第二个解析空白：在逗号之后处理空白
-
-            // 值之后若为逗号，将当前字符的位置右移一位，然后处理逗号之后的空白
-            if (*m_cur == ',')
-            {
+        }
+    }
+    bool JsonParser::ParseValueStart()
+    {
+        // 每个值占用容器中的一个 JsonValue
+        if (m_limited)
+        {
+            if (m_maxNodes != 0 && ++m_nodes > m_maxNodes)
+                throw(JsonException("parse limit exceeded"));
+            Charge(sizeof(JsonValue));
+        }
+        switch (*m_cur)
+        {
+        case 'n':
+            ParseLiteral("null", JsonType::Null);
+            return false;
+        case 't':
+            ParseLiteral("true", JsonType::True);
+            return false;
+        case 'f':
+            ParseLiteral("false", JsonType::False);
+            return false;
+        case '\"':
+            ParseString();
+            return false;
+        case '[':
+            PushFrame(JsonType::Array);
+            ++m_cur;
+            ParseWhitespace(); // 在左括号之后解析空白
+            if (*m_cur == ']')
+            { // 空数组直接结束
                 ++m_cur;
-                ParseWhitespace(); // 第三个解析空白：在逗号之后处理空白
+                m_frames.pop_back();
+                EndArray(m_values.size());
+                return false;
             }
-
-            // 值之后若为右括号，则将当前字符的位置右移一位，然后将 val_ 设置为数组 tmp
-            else if (*m_cur == ']')
-            {
+            return true;
+        case '{':
+            PushFrame(JsonType::Object);
+            ++m_cur;
+            ParseWhitespace(); // 在左花括号之后处理空白
+            if (*m_cur == '}')
+            { // 空对象直接结束
                 ++m_cur;
-                m_val.SetArray(tmp);
-                return;
+                m_frames.pop_back();
+                EndObject(m_values.size(), m_keyTop);
+                return false;
             }
-
-            // 若遇到解析失败，则直接抛出异常
-            else
+            if (!ParseMemberKey())
             {
-                m_val.SetType(JsonType::Null);
-                throw(JsonException("parse miss comma or square bracket"));
+                m_frames.pop_back();
+                EndObject(m_values.size(), m_keyTop);
+                return false;
             }
+            return true;
+        case '\0':
+            throw(JsonException("parse expect value"));
+        default:
+            ParseNumber();
+            return false;
         }
     }
-    void JsonParser::ParseObject()
+    void JsonParser::PushFrame(JsonType::type t)
     {
-        Expect(m_cur, '{'); // 先跳过左花括号
-        ParseWhitespace();  // 第一个解析空白：在左花括号之后处理空白
-        std::vector<std::pair<std::string, JsonValue>> tmp;
-        std::string key;
-
-        // 遇到对象的右花括号，然后将当前字符的位置右移一位，然后 val_ 设置为对象 tmp
-        if (*m_cur == '}')
+        // 超过最大嵌套深度时干净地失败，而不是耗尽内存
+        if (m_maxDepth != 0 && m_frames.size() >= m_maxDepth)
+            throw(JsonException("parse too deep"));
+        if (m_limited)
+            Charge(t == JsonType::Array ? sizeof(JsonShared<JsonArray>) : sizeof(JsonShared<JsonObject>));
+        m_frames.push_back(Frame{t, m_values.size(), m_keyTop, m_node});
+    }
+    void JsonParser::ParseLiteral(const char *literal, JsonType::type t)
+    {
+        // 解析成功后设置 val_ 的类型为 t
+        SJSON_TRACE_SCOPE(m_profile, Literal, m_cur);
+        JsonLexer::ScanLiteral(m_cur, literal);
+        m_val.SetType(t);
+    }
+    void JsonParser::ParseNumber()
+    {
+        SJSON_TRACE_SCOPE(m_profile, Number, m_cur);
+        JsonNumber num;
+        const char *start = m_cur;
+        if (!m_lazyNumbers)
+            JsonLexer::ScanNumber(m_cur, num);
+        else
         {
-            ++m_cur;
-            m_val.SetObject(tmp);
-            return;
+            JsonLexer::ScanNumberLazy(m_cur, num);
+            if (num.kind == JsonNumberKind::Double)
+            {
+                size_t size = m_cur - start;
+                if (m_limited && size > sizeof(m_val.m_text))
+                    Charge(sizeof(JsonShared<std::string>) + size);
+                // 长的原文放到回收池中取出的字符串负载里
+                if (size <= sizeof(m_val.m_text))
+                    m_val.SetNumberText(start, size);
+                else
+                {
+                    JsonShared<std::string> *block = TakeString();
+                    block->data.assign(start, size);
+                    m_val.SetType(JsonType::Number);
+                    m_val.m_numKind = JsonValue::TextShared;
+                    m_val.m_string = block;
+                }
+                return;
+            }
+        }
+        switch (num.kind)
+        {
+        case JsonNumberKind::Int64:
+            m_val.SetInt64(num.i);
+            break;
+        case JsonNumberKind::Uint64:
+            m_val.SetUint64(num.u);
+            break;
+        default:
+            m_val.SetNumber(num.d);
+            break;
         }
+    }
+    void JsonParser::ParseString()
+    {
+        // 用缓冲区 m_buffer 来保存解析出来的字符串，然后拷贝到回收池中取出的负载里
+        m_buffer.clear();
+        if (!ParseStringRaw(m_buffer))
+            throw(JsonException("parse limit exceeded"));
+        if (m_limited)
+            Charge(sizeof(JsonShared<std::string>) + m_buffer.size());
+        JsonShared<std::string> *block = TakeString();
+        block->data.assign(m_buffer);
+        m_val.SetType(JsonType::String);
+        m_val.m_string = block;
+    }
+    bool JsonParser::ParseStringRaw(std::string &tmp)
+    {
+        SJSON_TRACE_SCOPE(m_profile, String, m_cur);
+        if (m_limited && m_maxStringLength != 0)
+            return JsonLexer::ScanString(m_cur, tmp, m_maxStringLength);
+        JsonLexer::ScanString(m_cur, tmp);
+        return true;
+    }
 
+    bool JsonParser::ParseMemberKey()
+    {
+        const JsonProjection::Node *node = m_frames.back().node;
         for (;;)
         {
-            /* 1、解析 key 值：若解析失败，则抛出异常 */
+            /* 1、解析 key 值：若解析失败，则抛出异常；key 直接解析到 key 栈中，复用上次的容量 */
             if (*m_cur != '\"')
                 throw(JsonException("parse miss key"));
+            if (m_keyTop == m_keys.size())
+                m_keys.emplace_back();
+            std::string &key = m_keys[m_keyTop];
+            key.clear();
+            bool fits;
             try
             {
-                ParseStringRaw(key);
+                fits = ParseStringRaw(key);
             }
-            catch (JsonException)
+            catch (const JsonException &)
             {
                 throw(JsonException("parse miss key"));
             }
+            if (!fits)
+                throw(JsonException("parse limit exceeded"));
 
             /* 2、解析"_:_"，冒号前后可有空白字符 */
-            ParseWhitespace(); // 第二个解析空白：处理冒号之前的所有空白
+            ParseWhitespace(); // 处理冒号之前的所有空白
             if (*m_cur++ != ':')
                 throw(JsonException("parse miss colon"));
-            ParseWhitespace(); // 第三个解析空白：处理冒号之后的所有空白
+            ParseWhitespace(); // 处理冒号之后的所有空白
 
-            /* 3、解析冒号之后的值 */
-            try
-            {
-                ParseValue();
-            }
-            catch (JsonException)
+            /* 3、不投影或者 key 被选中时保留这个成员 */
+            const JsonProjection::Node *child = node != nullptr ? node->Find(key) : nullptr;
+            if (node == nullptr || child != nullptr)
             {
-                m_val.SetType(JsonType::Null);
-                throw;
+                // 成员比数组元素多占一个 key
+                if (m_limited)
+                    Charge(sizeof(std::string) + key.size());
+                ++m_keyTop;
+                m_node = child != nullptr && !child->leaf ? child : nullptr;
+                return true;
             }
 
-            // 把解析到的值存入 tmp 中，然后将解析到的 val_ 设置为 null，并将 key 进行清空
-            tmp.push_back(std::make_pair(key, m_val));
-            m_val.SetType(JsonType::Null);
-            key.clear();
-
-            /* 4、解析 "_,_" 或 "_}" */
-            ParseWhitespace(); // 第四个解析空白：处理逗号或右花括号之前的空白
+            /* 4、未选中的值只校验并跳过，不建立任何值 */
+            JsonLexer::SkipValue(m_cur, m_brackets);
+            ParseWhitespace();
             if (*m_cur == ',')
-            { // 处理逗号
-                ++m_cur;
-                ParseWhitespace(); // 第五个解析空白：处理逗号之后的空白
-            }
-            else if (*m_cur == '}')
-            { // 处理右花括号：将当前字符的位置右移一位，并设置 val_ 为对象 tmp
+            {
                 ++m_cur;
-                m_val.SetObject(tmp);
-                return;
+                ParseWhitespace();
+                continue;
             }
-            else
-            { // 若解析失败，则将 val_ 的类型设置为 null，并抛出异常
-                m_val.SetType(JsonType::Null);
+            if (*m_cur != '}')
                 throw(JsonException("parse miss comma or curly bracket"));
-            }
+            ++m_cur;
+            return false;
+        }
+    }
+    void JsonParser::EndArray(size_t base)
+    {
+        // 把栈中从 base 开始的元素移入数组
+        SJSON_TRACE_SCOPE(m_profile, Container, (m_values.size() - base) * sizeof(JsonValue));
+        JsonShared<JsonArray> *block = TakeArray();
+        block->data.insert(block->data.end(),
+                           std::make_move_iterator(m_values.begin() + base),
+                           std::make_move_iterator(m_values.end()));
+        m_values.resize(base);
+        m_val.SetType(JsonType::Array);
+        m_val.m_array = block;
+    }
+    void JsonParser::EndObject(size_t base, size_t keyBase)
+    {
+        // 把栈中从 base、keyBase 开始的成员移入对象
+        size_t n = m_keyTop - keyBase;
+        SJSON_TRACE_SCOPE(m_profile, Container, n * sizeof(JsonObject::value_type));
+        JsonShared<JsonObject> *block = TakeObject();
+        JsonObject &obj = block->data;
+        obj.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            obj[i].first.assign(m_keys[keyBase + i]);
+            obj[i].second = std::move(m_values[base + i]);
         }
+        m_values.resize(base);
+        m_keyTop = keyBase;
+        m_val.SetType(JsonType::Object);
+        m_val.m_object = block;
     }
 }
\ No newline at end of file
@@ -2,37 +2,132 @@
 #define JSONPARSER_H
 #include "JsonValue.h"
 #include "Json.h"
+#include "JsonTrace.h"
+#include "JsonProjection.h"
 
 namespace SJson
 {
+    /*
+     * JsonParser 可以长期持有并反复使用：字符串缓冲区、容器栈在多次解析之间保留容量；
+     * 解析到已有的 Json 时，旧文档中独占的字符串、数组、对象负载会被回收，供新文档复用。
+     */
     class JsonParser
     {
     public:
+        JsonParser() noexcept;
+        /* 一次性解析 */
         JsonParser(JsonValue &val, const std::string &content);
+        ~JsonParser() noexcept;
+        JsonParser(const JsonParser &) = delete;
+        JsonParser &operator=(const JsonParser &) = delete;
+
+        void Parse(JsonValue &val, const std::string &content);
+        void Parse(Json &json, const std::string &content);
+        void Parse(Json &json, const std::string &content, std::string &status) noexcept;
+        /* 只建立投影选中的字段，其余的值校验后跳过 */
+        void Parse(Json &json, const std::string &content, const JsonProjection &projection);
+        void Parse(Json &json, const std::string &content, const JsonProjection &projection, std::string &status) noexcept;
+        /* 最大嵌套深度，超过时报 "parse too deep"；0 表示不限制 */
+        void SetMaxDepth(size_t depth) noexcept;
+        /*
+         * 单次解析的资源上限，0 表示不限制，超过任一上限时报 "parse limit exceeded"；全部为 0 时解析不做任何计数。
+         * 字节数按文档中分配的节点、负载估算（不含解析器自身的缓冲区），投影跳过的值不计入；边解析边检查，超限后立即停止。
+         */
+        void SetMaxBytes(size_t bytes) noexcept;
+        /* 值的总个数，包括数组、对象本身 */
+        void SetMaxNodes(size_t nodes) noexcept;
+        /* 单个字符串、key 解码后的字节数 */
+        void SetMaxStringLength(size_t length) noexcept;
+        /* 单个数组的元素个数、对象的成员个数 */
+        void SetMaxContainerSize(size_t size) noexcept;
+        /* 严格模式：解析前先校验整个输入是否为合法的 utf-8，不合法时报 "parse invalid utf8"；默认关闭 */
+        void SetValidateUtf8(bool validate) noexcept;
+        /* 延迟转换数字：整数照常转换，其他数字只校验并保存原文，第一次读取时才转换，Stringify 原样输出原文；默认关闭 */
+        void SetLazyNumbers(bool lazy) noexcept;
+        /* 最近一次解析失败的位置（相对输入起始的字节偏移）：出错的记号的起始位置，utf-8 错误为非法序列的首字节 */
+        size_t GetErrorOffset() const noexcept;
+        /* 设置后每次解析成功时把结果文档的内存统计写入 stats；传入 nullptr 关闭统计 */
+        void SetStats(JsonStats *stats) noexcept;
+        /* 最近一次解析的分阶段统计，编译时定义 SJSON_TRACE 才有数据 */
+        const JsonProfile &GetLastParseProfile() const noexcept;
+        /* 释放保留的缓冲区和回收池 */
+        void ReleaseScratch() noexcept;
 
     private:
+        /* 解析整个文档，root 为投影的根，nullptr 表示不投影 */
+        void ParseDocument(JsonValue &val, const std::string &content, const JsonProjection::Node *root);
         /* 处理空白 */
         void ParseWhitespace() noexcept;
-        /* 解析 json 值 */
+        /* 解析 json 值：不递归，嵌套的数组和对象记录在 m_frames 中 */
         void ParseValue();
+        /* 解析一个值的开头，遇到非空的数组或对象时返回 true */
+        bool ParseValueStart();
         /* 合并 false、true、null 的解析函数 */
         void ParseLiteral(const char *literal, JsonType::type t);
         /* 解析数字 */
         void ParseNumber();
         /* 解析字符串的函数拆分为两部分，是为了在解析 json 对象的 key 值时，不使用 lept_value 存储键，因为这样会浪费其中的 type 这个无用字段 */
         void ParseString();
-        /* 解析 字符串 */
-        void ParseStringRaw(std::string &tmp);
-        /* 解析Hex */
-        void ParseHex4(const char *&p, unsigned &u);
-        /* 解析utf-8 */
-        void ParseUTF8(std::string &str, unsigned u);
-        /* 解析Array */
-        void ParseArray();
-        /* 解析Object */
-        void ParseObject();
-        JsonValue &m_val;
-        const char *m_cur;
+        /* 解析 字符串，超过 SetMaxStringLength 时停止解码并返回 false */
+        bool ParseStringRaw(std::string &tmp);
+        /* 计入 bytes 字节的分配，超过上限时抛出异常；只在设置了上限时调用 */
+        void Charge(size_t bytes);
+        /* 进入一层数组或对象 */
+        void PushFrame(JsonType::type t);
+        /* 解析对象成员的 key 和冒号；投影时跳过未选中的成员，遇到右花括号返回 false */
+        bool ParseMemberKey();
+        /* 数组、对象结束时，把栈中的元素移入容器 */
+        void EndArray(size_t base);
+        void EndObject(size_t base, size_t keyBase);
+
+        /* 回收旧文档中独占的负载，从回收池中取负载 */
+        void Recycle(JsonValue &val) noexcept;
+        JsonShared<std::string> *TakeString();
+        JsonShared<JsonArray> *TakeArray();
+        JsonShared<JsonObject> *TakeObject();
+
+        /* 当前解析出的值 */
+        JsonValue m_val;
+        const char *m_cur = nullptr;
+        /* 字符串缓冲区 */
+        std::string m_buffer;
+        /* 容器栈：所有层级的数组元素、对象成员都压在同一个栈上，容器结束时再弹出 */
+        std::vector<JsonValue> m_values;
+        std::vector<std::string> m_keys;
+        size_t m_keyTop = 0;
+        /* 每一层尚未结束的数组或对象：类型以及它的元素、key 在栈中的起始位置 */
+        struct Frame
+        {
+            JsonType::type type;
+            size_t base;
+            size_t keyBase;
+            /* 这一层的投影，nullptr 表示整层都要建立 */
+            const JsonProjection::Node *node;
+        };
+        std::vector<Frame> m_frames;
+        size_t m_maxDepth = 0;
+        /* 资源上限与本次解析的计数，m_limited 为 false 时都不使用 */
+        bool m_limited = false;
+        size_t m_maxBytes = 0;
+        size_t m_maxNodes = 0;
+        size_t m_maxStringLength = 0;
+        size_t m_maxContainerSize = 0;
+        size_t m_bytes = 0;
+        size_t m_nodes = 0;
+        bool m_validateUtf8 = false;
+        bool m_lazyNumbers = false;
+        size_t m_errorOffset = 0;
+        /* 下一个值的投影 */
+        const JsonProjection::Node *m_node = nullptr;
+        /* 跳过未选中的值时使用的括号栈 */
+        std::string m_brackets;
+        JsonStats *m_stats = nullptr;
+        JsonProfile m_profile;
+        size_t m_reused = 0;
+        /* 回收池 */
+        std::vector<JsonShared<std::string> *> m_freeStrings;
+        std::vector<JsonShared<JsonArray> *> m_freeArrays;
+        std::vector<JsonShared<JsonObject> *> m_freeObjects;
     };
 }
-#endif // JSONPARSE_H
\ No newline at end of file
+#endif // JSONPARSE_H
@@ -0,0 +1,402 @@
+#include <assert.h>
+#include <utility>
+#include "JsonPatch.h"
+#include "JsonException.h"
+namespace SJson
+{
+    void JsonPatcher::Apply(const JsonValue &input)
+    {
+        // patch 可能就是被修改的文档或其中的一部分：先共享一份（只增加引用计数），修改文档时负载被复制，patch 保持不变
+        const JsonValue patch(input);
+        if (patch.GetType() != JsonType::Array)
+            throw(JsonException("patch invalid"));
+        m_undo.clear();
+        try
+        {
+            for (size_t i = 0, n = patch.GetArraySize(); i < n; ++i)
+                ApplyOperation(patch.GetArrayElement(i));
+        }
+        catch (...)
+        {
+            // 某个操作失败：撤销之前已经生效的操作
+            Rollback();
+            m_undo.clear();
+            throw;
+        }
+        m_undo.clear();
+    }
+
+    void JsonPatcher::ApplyOperation(const JsonValue &op)
+    {
+        if (op.GetType() != JsonType::Object)
+            throw(JsonException("patch invalid operation"));
+        auto member = [&op](const char *name) -> const JsonValue * {
+            auto index = op.FindObjectIndex(name);
+            return index < 0 ? nullptr : &op.GetObjectValue(index);
+        };
+        const JsonValue *name = member("op");
+        const JsonValue *path = member("path");
+        if (name == nullptr || name->GetType() != JsonType::String ||
+            path == nullptr || path->GetType() != JsonType::String)
+            throw(JsonException("patch invalid operation"));
+
+        Pointer target;
+        ParsePointer(path->GetString(), target);
+        const std::string &opName = name->GetString();
+        if (opName == "add" || opName == "replace" || opName == "test")
+        {
+            const JsonValue *value = member("value");
+            if (value == nullptr)
+                throw(JsonException("patch invalid operation"));
+            if (opName == "add")
+                Add(target, JsonValue(*value));
+            else if (opName == "replace")
+                Replace(target, JsonValue(*value));
+            else
+            {
+                const JsonValue *actual = Find(target);
+                if (actual == nullptr)
+                    throw(JsonException("patch path not found"));
+                if (*actual != *value)
+                    throw(JsonException("patch test failed"));
+            }
+        }
+        else if (opName == "remove")
+            Remove(target);
+        else if (opName == "move" || opName == "copy")
+        {
+            const JsonValue *from = member("from");
+            if (from == nullptr || from->GetType() != JsonType::String)
+                throw(JsonException("patch invalid operation"));
+            Pointer source;
+            ParsePointer(from->GetString(), source);
+            if (opName == "copy")
+            {
+                const JsonValue *src = Find(source);
+                if (src == nullptr)
+                    throw(JsonException("patch path not found"));
+                // 拷贝只共享负载，耗时 O(1)
+                Add(target, JsonValue(*src));
+                return;
+            }
+            if (source == target)
+                return;
+            // 不能把一个值移动到它自己的子节点中
+            if (source.size() < target.size() && std::equal(source.begin(), source.end(), target.begin()))
+                throw(JsonException("patch invalid path"));
+            Add(target, Remove(source));
+        }
+        else
+            throw(JsonException("patch invalid operation"));
+    }
+
+    void JsonPatcher::ParsePointer(const std::string &path, Pointer &tokens)
+    {
+        // RFC 6901：空串表示根，否则以 '/' 分隔，~1 表示 '/'，~0 表示 '~'
+        tokens.clear();
+        if (path.empty())
+            return;
+        if (path[0] != '/')
+            throw(JsonException("patch invalid path"));
+        for (size_t i = 1, n = path.size();; ++i)
+        {
+            tokens.emplace_back();
+            std::string &token = tokens.back();
+            for (; i < n && path[i] != '/'; ++i)
+            {
+                if (path[i] != '~')
+                    token += path[i];
+                else if (i + 1 < n && path[i + 1] == '0')
+                    token += '~', ++i;
+                else if (i + 1 < n && path[i + 1] == '1')
+                    token += '/', ++i;
+                else
+                    throw(JsonException("patch invalid path"));
+            }
+            if (i >= n)
+                break;
+        }
+    }
+
+    bool JsonPatcher::ParseIndex(const std::string &token, size_t size, bool allowEnd, size_t &index)
+    {
+        // "-" 表示数组末尾之后的位置，只能用于 add；下标不能有前导 0
+        if (token == "-")
+        {
+            index = size;
+            return allowEnd;
+        }
+        if (token.empty() || token.size() > 19 || (token.size() > 1 && token[0] == '0'))
+            return false;
+        index = 0;
+        for (char ch : token)
+        {
+            if (ch < '0' || ch > '9')
+                return false;
+            index = index * 10 + (ch - '0');
+        }
+        return allowEnd ? index <= size : index < size;
+    }
+
+    const JsonValue *JsonPatcher::Find(const Pointer &path) const noexcept
+    {
+        const JsonValue *cur = &m_root;
+        for (auto &token : path)
+        {
+            if (cur->GetType() == JsonType::Object)
+            {
+                auto index = cur->FindObjectIndex(token);
+                if (index < 0)
+                    return nullptr;
+                cur = &cur->GetObjectValue(index);
+            }
+            else if (cur->GetType() == JsonType::Array)
+            {
+                size_t index;
+                if (!ParseIndex(token, cur->GetArraySize(), false, index))
+                    return nullptr;
+                cur = &cur->GetArrayElement(index);
+            }
+            else
+                return nullptr;
+        }
+        return cur;
+    }
+
+    JsonValue &JsonPatcher::FindMutable(const Pointer &path, size_t n)
+    {
+        JsonValue *cur = &m_root;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const std::string &token = path[i];
+            if (cur->GetType() == JsonType::Object)
+            {
+                auto index = cur->FindObjectIndex(token);
+                if (index < 0)
+                    throw(JsonException("patch path not found"));
+                cur = &cur->GetMutableObjectValue(index);
+            }
+            else if (cur->GetType() == JsonType::Array)
+            {
+                size_t index;
+                if (!ParseIndex(token, cur->GetArraySize(), false, index))
+                    throw(JsonException("patch path not found"));
+                cur = &cur->GetMutableArrayElement(index);
+            }
+            else
+                throw(JsonException("patch path not found"));
+        }
+        return *cur;
+    }
+
+    void JsonPatcher::Add(const Pointer &path, JsonValue &&val)
+    {
+        if (path.empty())
+        {
+            m_undo.push_back(Undo{Undo::ReplaceRoot, Pointer(), 0, std::string(), std::move(m_root)});
+            m_root = std::move(val);
+            return;
+        }
+        JsonValue &parent = FindMutable(path, path.size() - 1);
+        const std::string &token = path.back();
+        Pointer parentPath(path.begin(), path.end() - 1);
+        if (parent.GetType() == JsonType::Object)
+        {
+            // 已存在的 key 替换它的值，否则追加新成员
+            auto index = parent.FindObjectIndex(token);
+            if (index >= 0)
+            {
+                JsonValue &slot = parent.GetMutableObjectValue(index);
+                m_undo.push_back(Undo{Undo::ReplaceObjectAt, std::move(parentPath), static_cast<size_t>(index), std::string(), std::move(slot)});
+                slot = std::move(val);
+            }
+            else
+            {
+                size_t size = parent.GetObjectSize();
+                parent.InsertObjectValue(size, token, std::move(val));
+                m_undo.push_back(Undo{Undo::EraseObjectAt, std::move(parentPath), size, std::string(), JsonValue()});
+            }
+        }
+        else if (parent.GetType() == JsonType::Array)
+        {
+            size_t index;
+            if (!ParseIndex(token, parent.GetArraySize(), true, index))
+                throw(JsonException("patch path not found"));
+            parent.InsertArrayElement(std::move(val), index);
+            m_undo.push_back(Undo{Undo::EraseArrayAt, std::move(parentPath), index, std::string(), JsonValue()});
+        }
+        else
+            throw(JsonException("patch path not found"));
+    }
+
+    JsonValue JsonPatcher::Remove(const Pointer &path)
+    {
+        if (path.empty())
+            throw(JsonException("patch invalid path"));
+        JsonValue &parent = FindMutable(path, path.size() - 1);
+        const std::string &token = path.back();
+        size_t index;
+        JsonValue removed;
+        if (parent.GetType() == JsonType::Object)
+        {
+            auto found = parent.FindObjectIndex(token);
+            if (found < 0)
+                throw(JsonException("patch path not found"));
+            index = static_cast<size_t>(found);
+            removed = std::move(parent.GetMutableObjectValue(index));
+            parent.RemoveObjectValue(index);
+            m_undo.push_back(Undo{Undo::InsertObjectAt, Pointer(path.begin(), path.end() - 1), index, token, removed});
+        }
+        else if (parent.GetType() == JsonType::Array)
+        {
+            if (!ParseIndex(token, parent.GetArraySize(), false, index))
+                throw(JsonException("patch path not found"));
+            removed = std::move(parent.GetMutableArrayElement(index));
+            parent.EraseArrayElement(index, 1);
+            m_undo.push_back(Undo{Undo::InsertArrayAt, Pointer(path.begin(), path.end() - 1), index, std::string(), removed});
+        }
+        else
+            throw(JsonException("patch path not found"));
+        return removed;
+    }
+
+    void JsonPatcher::Replace(const Pointer &path, JsonValue &&val)
+    {
+        if (path.empty())
+        {
+            m_undo.push_back(Undo{Undo::ReplaceRoot, Pointer(), 0, std::string(), std::move(m_root)});
+            m_root = std::move(val);
+            return;
+        }
+        JsonValue &parent = FindMutable(path, path.size() - 1);
+        const std::string &token = path.back();
+        JsonValue *slot;
+        size_t index;
+        Undo::Kind kind;
+        if (parent.GetType() == JsonType::Object)
+        {
+            auto found = parent.FindObjectIndex(token);
+            if (found < 0)
+                throw(JsonException("patch path not found"));
+            index = static_cast<size_t>(found);
+            slot = &parent.GetMutableObjectValue(index);
+            kind = Undo::ReplaceObjectAt;
+        }
+        else if (parent.GetType() == JsonType::Array)
+        {
+            if (!ParseIndex(token, parent.GetArraySize(), false, index))
+                throw(JsonException("patch path not found"));
+            slot = &parent.GetMutableArrayElement(index);
+            kind = Undo::ReplaceArrayAt;
+        }
+        else
+            throw(JsonException("patch path not found"));
+        m_undo.push_back(Undo{kind, Pointer(path.begin(), path.end() - 1), index, std::string(), std::move(*slot)});
+        *slot = std::move(val);
+    }
+
+    void JsonPatcher::Rollback() noexcept
+    {
+        // 逆序撤销：每一步撤销前的文档状态与该操作刚生效后的状态一致，记录的下标仍然有效
+        for (auto it = m_undo.rbegin(); it != m_undo.rend(); ++it)
+        {
+            Undo &u = *it;
+            if (u.kind == Undo::ReplaceRoot)
+            {
+                m_root = std::move(u.value);
+                continue;
+            }
+            JsonValue *parent;
+            try
+            {
+                parent = &FindMutable(u.parent, u.parent.size());
+            }
+            catch (...)
+            {
+                assert(0 && "patch undo path lost");
+                return;
+            }
+            switch (u.kind)
+            {
+            case Undo::EraseArrayAt:
+                parent->EraseArrayElement(u.index, 1);
+                break;
+            case Undo::InsertArrayAt:
+                parent->InsertArrayElement(std::move(u.value), u.index);
+                break;
+            case Undo::ReplaceArrayAt:
+                parent->GetMutableArrayElement(u.index) = std::move(u.value);
+                break;
+            case Undo::EraseObjectAt:
+                parent->RemoveObjectValue(u.index);
+                break;
+            case Undo::InsertObjectAt:
+                parent->InsertObjectValue(u.index, u.key, std::move(u.value));
+                break;
+            case Undo::ReplaceObjectAt:
+                parent->GetMutableObjectValue(u.index) = std::move(u.value);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void JsonPatcher::Merge(const JsonValue &input) noexcept
+    {
+        // 与 Apply 相同，patch 与文档可能是同一个值
+        const JsonValue patch(input);
+        // RFC 7396，用显式的栈代替递归，每一项是 (目标节点, patch 节点)
+        std::vector<std::pair<JsonValue *, const JsonValue *>> work{{&m_root, &patch}};
+        std::vector<std::pair<size_t, const JsonValue *>> nested;
+        while (!work.empty())
+        {
+            JsonValue &target = *work.back().first;
+            const JsonValue &p = *work.back().second;
+            work.pop_back();
+            if (p.GetType() != JsonType::Object)
+            {
+                target = p;
+                continue;
+            }
+            if (target.GetType() != JsonType::Object)
+                target.SetObject(JsonObject());
+
+            // 第一遍：删除值为 null 的成员
+            for (size_t i = 0, n = p.GetObjectSize(); i < n; ++i)
+            {
+                if (p.GetObjectValue(i).GetType() != JsonType::Null)
+                    continue;
+                auto index = target.FindObjectIndex(p.GetObjectKey(i));
+                if (index >= 0)
+                    target.RemoveObjectValue(index);
+            }
+            // 第二遍：非对象的值直接赋值，对象值记下目标的下标，之后不再改变 target 的成员布局
+            nested.clear();
+            for (size_t i = 0, n = p.GetObjectSize(); i < n; ++i)
+            {
+                const JsonValue &pv = p.GetObjectValue(i);
+                if (pv.GetType() == JsonType::Null)
+                    continue;
+                const std::string &key = p.GetObjectKey(i);
+                auto index = target.FindObjectIndex(key);
+                if (pv.GetType() != JsonType::Object)
+                {
+                    if (index >= 0)
+                        target.GetMutableObjectValue(index) = pv;
+                    else
+                        target.InsertObjectValue(target.GetObjectSize(), key, JsonValue(pv));
+                    continue;
+                }
+                if (index < 0)
+                {
+                    index = target.GetObjectSize();
+                    target.InsertObjectValue(index, key, JsonValue());
+                }
+                nested.emplace_back(static_cast<size_t>(index), &pv);
+            }
+            for (auto &n : nested)
+                work.emplace_back(&target.GetMutableObjectValue(n.first), n.second);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef JSONPATCH_H
+#define JSONPATCH_H
+#include <string>
+#include <vector>
+#include "JsonValue.h"
+
+namespace SJson
+{
+    /*
+     * 原地应用 RFC 6902 JSON Patch 与 RFC 7396 JSON Merge Patch。
+     * 每个操作只沿 JSON Pointer 走一遍找到目标，值用移动放到位，共享的负载只复制被修改的路径；
+     * 任何一个操作失败时按撤销日志逆序回滚，整个 patch 要么全部生效，要么都不生效。
+     */
+    class JsonPatcher
+    {
+    public:
+        explicit JsonPatcher(JsonValue &root) noexcept : m_root(root) {}
+
+        void Apply(const JsonValue &patch);
+        void Merge(const JsonValue &patch) noexcept;
+
+    private:
+        using Pointer = std::vector<std::string>;
+
+        /* 撤销日志：记录父节点的路径以及如何恢复 */
+        struct Undo
+        {
+            enum Kind
+            {
+                EraseArrayAt,
+                InsertArrayAt,
+                ReplaceArrayAt,
+                EraseObjectAt,
+                InsertObjectAt,
+                ReplaceObjectAt,
+                ReplaceRoot
+            } kind;
+            Pointer parent;
+            size_t index;
+            std::string key;
+            JsonValue value;
+        };
+
+        void ApplyOperation(const JsonValue &op);
+        static void ParsePointer(const std::string &path, Pointer &tokens);
+        static bool ParseIndex(const std::string &token, size_t size, bool allowEnd, size_t &index);
+        /* 查找目标，找不到返回 nullptr */
+        const JsonValue *Find(const Pointer &path) const noexcept;
+        /* 沿 path 的前 n 个 token 找到可修改的节点，共享的负载在这里复制 */
+        JsonValue &FindMutable(const Pointer &path, size_t n);
+
+        void Add(const Pointer &path, JsonValue &&val);
+        JsonValue Remove(const Pointer &path);
+        void Replace(const Pointer &path, JsonValue &&val);
+        void Rollback() noexcept;
+
+        JsonValue &m_root;
+        std::vector<Undo> m_undo;
+    };
+}
+#endif // JSONPATCH_H
@@ -0,0 +1,64 @@
+#include "JsonProjection.h"
+#include "JsonException.h"
+namespace SJson
+{
+    const JsonProjection::Node *JsonProjection::Node::Find(std::string_view key) const noexcept
+    {
+        // 投影通常只有几个字段，线性查找即可
+        for (const auto &child : children)
+        {
+            if (child.first == key)
+                return child.second.get();
+        }
+        return nullptr;
+    }
+
+    JsonProjection::JsonProjection(std::initializer_list<const char *> paths)
+    {
+        for (const char *path : paths)
+            Add(path);
+    }
+
+    void JsonProjection::Add(const std::string &path)
+    {
+        if (!path.empty() && path[0] != '/')
+            throw(JsonException("projection invalid path"));
+        Node *node = &m_root;
+        size_t pos = 0;
+        while (pos < path.size() && !node->leaf)
+        {
+            size_t end = path.find('/', pos + 1);
+            if (end == std::string::npos)
+                end = path.size();
+            std::string key;
+            for (size_t i = pos + 1; i < end; ++i)
+            {
+                if (path[i] != '~')
+                    key += path[i];
+                else if (i + 1 < end && (path[i + 1] == '0' || path[i + 1] == '1'))
+                    key += path[++i] == '0' ? '~' : '/';
+                else
+                    throw(JsonException("projection invalid path"));
+            }
+            Node *next = nullptr;
+            for (auto &child : node->children)
+            {
+                if (child.first == key)
+                {
+                    next = child.second.get();
+                    break;
+                }
+            }
+            if (next == nullptr)
+            {
+                node->children.emplace_back(std::move(key), std::unique_ptr<Node>(new Node));
+                next = node->children.back().second.get();
+            }
+            node = next;
+            pos = end;
+        }
+        // 路径的终点选中整个子树，之前添加的更深的路径不再需要
+        node->leaf = true;
+        node->children.clear();
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef JSONPROJECTION_H
+#define JSONPROJECTION_H
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace SJson
+{
+    /*
+     * 字段投影：解析时只建立选中的 key 路径，其余的值只校验并跳过。
+     * 路径使用 JSON Pointer 的写法（"/user/name"，~0 表示 '~'，~1 表示 '/'），多条路径组成一棵小树。
+     * 路径上遇到数组时，投影作用于数组的每一个元素；路径经过的值不是对象或数组时按原样保留。
+     */
+    class JsonProjection
+    {
+    public:
+        struct Node
+        {
+            /* 为 true 时整个子树都被选中 */
+            bool leaf = false;
+            std::vector<std::pair<std::string, std::unique_ptr<Node>>> children;
+            /* 查找 key 对应的子节点，不存在时返回 nullptr */
+            const Node *Find(std::string_view key) const noexcept;
+        };
+
+        JsonProjection() noexcept = default;
+        JsonProjection(std::initializer_list<const char *> paths);
+        /* 添加一条路径；空路径表示选中整个文档 */
+        void Add(const std::string &path);
+        const Node &GetRoot() const noexcept { return m_root; }
+
+    private:
+        Node m_root;
+    };
+}
+#endif // JSONPROJECTION_H
@@ -0,0 +1,165 @@
+#include <assert.h>
+#include "JsonReader.h"
+#include "JsonLexer.h"
+#include "JsonException.h"
+namespace SJson
+{
+    int JsonReader::PeekType()
+    {
+        JsonLexer::SkipWhitespace(m_cur);
+        switch (*m_cur)
+        {
+        case 'n':
+            return JsonType::Null;
+        case 't':
+            return JsonType::True;
+        case 'f':
+            return JsonType::False;
+        case '\"':
+            return JsonType::String;
+        case '[':
+            return JsonType::Array;
+        case '{':
+            return JsonType::Object;
+        case '\0':
+            throw(JsonException("parse expect value"));
+        default:
+            // 不合法的数字在 ReadNumber 中报错
+            return JsonType::Number;
+        }
+    }
+
+    void JsonReader::ReadNull()
+    {
+        JsonLexer::ScanLiteral(m_cur, "null");
+    }
+
+    bool JsonReader::ReadBoolean()
+    {
+        if (*m_cur == 't')
+        {
+            JsonLexer::ScanLiteral(m_cur, "true");
+            return true;
+        }
+        JsonLexer::ScanLiteral(m_cur, "false");
+        return false;
+    }
+
+    double JsonReader::ReadNumber()
+    {
+        return JsonLexer::ScanNumber(m_cur);
+    }
+
+    void JsonReader::ReadNumber(JsonNumber &num)
+    {
+        JsonLexer::ScanNumber(m_cur, num);
+    }
+
+    void JsonReader::ReadString(std::string &str)
+    {
+        str.clear();
+        JsonLexer::ScanString(m_cur, str);
+    }
+
+    bool JsonReader::BeginArray()
+    {
+        assert(*m_cur == '[');
+        ++m_cur;
+        JsonLexer::SkipWhitespace(m_cur);
+        if (*m_cur == ']')
+        {
+            ++m_cur;
+            return false;
+        }
+        return true;
+    }
+
+    bool JsonReader::NextArrayElement()
+    {
+        JsonLexer::SkipWhitespace(m_cur);
+        if (*m_cur == ',')
+        {
+            ++m_cur;
+            JsonLexer::SkipWhitespace(m_cur);
+            return true;
+        }
+        if (*m_cur != ']')
+            throw(JsonException("parse miss comma or square bracket"));
+        ++m_cur;
+        return false;
+    }
+
+    bool JsonReader::BeginObject(std::string_view &key)
+    {
+        assert(*m_cur == '{');
+        ++m_cur;
+        JsonLexer::SkipWhitespace(m_cur);
+        if (*m_cur == '}')
+        {
+            ++m_cur;
+            return false;
+        }
+        ReadKey(key);
+        return true;
+    }
+
+    bool JsonReader::NextObjectMember(std::string_view &key)
+    {
+        JsonLexer::SkipWhitespace(m_cur);
+        if (*m_cur == ',')
+        {
+            ++m_cur;
+            JsonLexer::SkipWhitespace(m_cur);
+            ReadKey(key);
+            return true;
+        }
+        if (*m_cur != '}')
+            throw(JsonException("parse miss comma or curly bracket"));
+        ++m_cur;
+        return false;
+    }
+
+    void JsonReader::ReadKey(std::string_view &key)
+    {
+        if (*m_cur != '\"')
+            throw(JsonException("parse miss key"));
+        // 快速路径：没有转义和控制字符的 key 直接引用输入
+        const char *p = m_cur + 1;
+        while (*p != '\"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20)
+            ++p;
+        if (*p == '\"')
+        {
+            key = std::string_view(m_cur + 1, p - m_cur - 1);
+            m_cur = p + 1;
+        }
+        else
+        {
+            m_scratch.clear();
+            try
+            {
+                JsonLexer::ScanString(m_cur, m_scratch);
+            }
+            catch (const JsonException &)
+            {
+                throw(JsonException("parse miss key"));
+            }
+            key = m_scratch;
+        }
+        JsonLexer::SkipWhitespace(m_cur);
+        if (*m_cur++ != ':')
+            throw(JsonException("parse miss colon"));
+        JsonLexer::SkipWhitespace(m_cur);
+    }
+
+    void JsonReader::SkipValue()
+    {
+        JsonLexer::SkipValue(m_cur, m_brackets);
+    }
+
+    void JsonReader::Finish()
+    {
+        JsonLexer::SkipWhitespace(m_cur);
+        if (*m_cur != '\0')
+            throw(JsonException("parse root not singular"));
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef JSONREADER_H
+#define JSONREADER_H
+#include <string>
+#include <string_view>
+#include "Json.h"
+#include "JsonLexer.h"
+
+namespace SJson
+{
+    /*
+     * 拉取式读取器：不建立 DOM，由调用者按顺序读取值，供结构体反序列化使用。
+     * key 没有转义时直接返回指向输入的视图，不需要的值用 SkipValue 校验并跳过，均不分配内存。
+     */
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(const char *content) noexcept : m_cur(content) {}
+        explicit JsonReader(const std::string &content) noexcept : m_cur(content.c_str()) {}
+
+        /* 跳过空白，根据下一个字符返回下一个值的类型 */
+        int PeekType();
+        void ReadNull();
+        bool ReadBoolean();
+        double ReadNumber();
+        /* 保留整数的原始表示，不经过 double */
+        void ReadNumber(JsonNumber &num);
+        void ReadString(std::string &str);
+
+        /* 数组：BeginArray 返回 false 表示空数组；每读完一个元素调用 NextArrayElement，返回 false 表示数组结束 */
+        bool BeginArray();
+        bool NextArrayElement();
+        /* 对象：返回 true 时 key 为下一个成员的 key，视图在读取下一个 key 之前有效 */
+        bool BeginObject(std::string_view &key);
+        bool NextObjectMember(std::string_view &key);
+
+        /* 校验并跳过一个完整的值 */
+        void SkipValue();
+        /* 确认之后只剩空白 */
+        void Finish();
+
+    private:
+        void ReadKey(std::string_view &key);
+        const char *m_cur;
+        /* 带转义的 key 解码到这里 */
+        std::string m_scratch;
+        /* SkipValue 中尚未闭合的括号 */
+        std::string m_brackets;
+    };
+}
+#endif // JSONREADER_H
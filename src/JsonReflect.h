@@ -0,0 +1,416 @@
+#ifndef JSONREFLECT_H
+#define JSONREFLECT_H
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "JsonFormat.h"
+#include "JsonReader.h"
+#include "JsonException.h"
+#include "JsonBatch.h"
+
+/*
+ * 结构体与 json 之间的直接映射，解析和生成都不经过 DOM。用法：
+ *
+ *     struct User { std::string name; int age; std::vector<std::string> tags; };
+ *     SJSON_REFLECT(User, name, age, tags)   // 写在 User 所在的命名空间中
+ *
+ *     User u;
+ *     SJson::ParseStruct(content, u);
+ *     SJson::StringifyStruct(u, content);
+ *
+ * 支持 bool、算术类型、std::string、std::vector、std::optional、以 std::string 为 key 的 map，
+ * 以及用 SJSON_REFLECT 声明过的结构体；其他类型可以特化 SJson::JsonCodec。
+ */
+#define SJSON_REFLECT(Type, ...)                                                                 \
+    inline constexpr auto SJsonFields(const Type *) noexcept                                     \
+    {                                                                                            \
+        return std::make_tuple(SJSON_FOR_EACH(SJSON_REFLECT_FIELD, Type, __VA_ARGS__));          \
+    }
+
+/* 同时在编译期拼出带前导逗号、引号和冒号的 key 字面量 ",\"name\":" */
+#define SJSON_REFLECT_FIELD(Type, name) \
+    ::SJson::JsonField<Type, decltype(Type::name)>(#name, sizeof(#name) - 1, ",\"" #name "\":", &Type::name)
+
+/* 对每个字段展开一次宏，最多 32 个字段 */
+#define SJSON_EXPAND(x) x
+#define SJSON_FE_1(m, t, x) m(t, x)
+#define SJSON_FE_2(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_1(m, t, __VA_ARGS__))
+#define SJSON_FE_3(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_2(m, t, __VA_ARGS__))
+#define SJSON_FE_4(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_3(m, t, __VA_ARGS__))
+#define SJSON_FE_5(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_4(m, t, __VA_ARGS__))
+#define SJSON_FE_6(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_5(m, t, __VA_ARGS__))
+#define SJSON_FE_7(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_6(m, t, __VA_ARGS__))
+#define SJSON_FE_8(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_7(m, t, __VA_ARGS__))
+#define SJSON_FE_9(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_8(m, t, __VA_ARGS__))
+#define SJSON_FE_10(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_9(m, t, __VA_ARGS__))
+#define SJSON_FE_11(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_10(m, t, __VA_ARGS__))
+#define SJSON_FE_12(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_11(m, t, __VA_ARGS__))
+#define SJSON_FE_13(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_12(m, t, __VA_ARGS__))
+#define SJSON_FE_14(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_13(m, t, __VA_ARGS__))
+#define SJSON_FE_15(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_14(m, t, __VA_ARGS__))
+#define SJSON_FE_16(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_15(m, t, __VA_ARGS__))
+#define SJSON_FE_17(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_16(m, t, __VA_ARGS__))
+#define SJSON_FE_18(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_17(m, t, __VA_ARGS__))
+#define SJSON_FE_19(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_18(m, t, __VA_ARGS__))
+#define SJSON_FE_20(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_19(m, t, __VA_ARGS__))
+#define SJSON_FE_21(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_20(m, t, __VA_ARGS__))
+#define SJSON_FE_22(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_21(m, t, __VA_ARGS__))
+#define SJSON_FE_23(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_22(m, t, __VA_ARGS__))
+#define SJSON_FE_24(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_23(m, t, __VA_ARGS__))
+#define SJSON_FE_25(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_24(m, t, __VA_ARGS__))
+#define SJSON_FE_26(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_25(m, t, __VA_ARGS__))
+#define SJSON_FE_27(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_26(m, t, __VA_ARGS__))
+#define SJSON_FE_28(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_27(m, t, __VA_ARGS__))
+#define SJSON_FE_29(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_28(m, t, __VA_ARGS__))
+#define SJSON_FE_30(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_29(m, t, __VA_ARGS__))
+#define SJSON_FE_31(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_30(m, t, __VA_ARGS__))
+#define SJSON_FE_32(m, t, x, ...) m(t, x), SJSON_EXPAND(SJSON_FE_31(m, t, __VA_ARGS__))
+#define SJSON_FE_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, NAME, ...) NAME
+#define SJSON_FOR_EACH(m, t, ...) \
+    SJSON_EXPAND(SJSON_FE_PICK(__VA_ARGS__, SJSON_FE_32, SJSON_FE_31, SJSON_FE_30, SJSON_FE_29, SJSON_FE_28, SJSON_FE_27, SJSON_FE_26, SJSON_FE_25, SJSON_FE_24, SJSON_FE_23, SJSON_FE_22, SJSON_FE_21, SJSON_FE_20, SJSON_FE_19, SJSON_FE_18, SJSON_FE_17, SJSON_FE_16, SJSON_FE_15, SJSON_FE_14, SJSON_FE_13, SJSON_FE_12, SJSON_FE_11, SJSON_FE_10, SJSON_FE_9, SJSON_FE_8, SJSON_FE_7, SJSON_FE_6, SJSON_FE_5, SJSON_FE_4, SJSON_FE_3, SJSON_FE_2, SJSON_FE_1)(m, t, __VA_ARGS__))
+
+namespace SJson
+{
+    /* 把 key 的长度和前 7 个字节压成一个整数，匹配字段时先比较这个整数 */
+    constexpr uint64_t JsonKeyTag(const char *key, size_t len) noexcept
+    {
+        uint64_t tag = static_cast<uint64_t>(len & 0xFF) << 56;
+        for (size_t i = 0; i < len && i < 7; ++i)
+            tag |= static_cast<uint64_t>(static_cast<unsigned char>(key[i])) << (8 * i);
+        return tag;
+    }
+
+    /* 字段描述：名字、编译期算好的匹配标签、生成时直接追加的 key 字面量、成员指针 */
+    template <typename T, typename M>
+    struct JsonField
+    {
+        constexpr JsonField(const char *n, size_t l, const char *q, M T::*m) noexcept
+            : name(n), len(l), tag(JsonKeyTag(n, l)), quoted(q), member(m) {}
+
+        bool Match(std::string_view key, uint64_t keyTag) const noexcept
+        {
+            // 标签只含长度的低 8 位，长度必须单独比较；长度相等且不超过 7 时标签相等即完全匹配，否则再比较剩余的字节
+            return keyTag == tag && key.size() == len &&
+                   (len <= 7 || memcmp(name + 7, key.data() + 7, len - 7) == 0);
+        }
+
+        const char *name;
+        size_t len;
+        uint64_t tag;
+        /* ",\"name\":"，长度为 len + 4 */
+        const char *quoted;
+        M T::*member;
+    };
+
+    /* 用 SJSON_REFLECT 声明过的类型 */
+    template <typename T, typename = void>
+    struct IsJsonReflected : std::false_type
+    {
+    };
+    template <typename T>
+    struct IsJsonReflected<T, std::void_t<decltype(SJsonFields(static_cast<const T *>(nullptr)))>>
+        : std::true_type
+    {
+    };
+
+    template <typename T>
+    inline constexpr auto JsonFieldsOf = SJsonFields(static_cast<const T *>(nullptr));
+
+    /* 每种类型的读写方式，可以为自定义类型特化 */
+    template <typename T, typename = void>
+    struct JsonCodec;
+
+    inline void ExpectJsonType(JsonReader &reader, int type)
+    {
+        if (reader.PeekType() != type)
+            throw(JsonException("parse type mismatch"));
+    }
+
+    template <>
+    struct JsonCodec<bool>
+    {
+        static void Read(JsonReader &reader, bool &value)
+        {
+            int t = reader.PeekType();
+            if (t != JsonType::True && t != JsonType::False)
+                throw(JsonException("parse type mismatch"));
+            value = reader.ReadBoolean();
+        }
+        static void Write(std::string &out, bool value)
+        {
+            out += value ? "true" : "false";
+        }
+    };
+
+    template <typename T>
+    struct JsonCodec<T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>>
+    {
+        static void Read(JsonReader &reader, T &value)
+        {
+            ExpectJsonType(reader, JsonType::Number);
+            if constexpr (std::is_integral_v<T>)
+            {
+                // 整数字段只接受范围内的整数值；整数不经过 double，超过 2^53 也不会丢失精度
+                JsonNumber num;
+                reader.ReadNumber(num);
+                bool inRange;
+                if (num.kind == JsonNumberKind::Int64)
+                {
+                    inRange = std::is_signed_v<T> ? num.i >= static_cast<int64_t>(std::numeric_limits<T>::min()) &&
+                                                        num.i <= static_cast<int64_t>(std::numeric_limits<T>::max())
+                                                  : num.i >= 0 && static_cast<uint64_t>(num.i) <= static_cast<uint64_t>(std::numeric_limits<T>::max());
+                    value = static_cast<T>(num.i);
+                }
+                else if (num.kind == JsonNumberKind::Uint64)
+                {
+                    inRange = num.u <= static_cast<uint64_t>(std::numeric_limits<T>::max());
+                    value = static_cast<T>(num.u);
+                }
+                else
+                {
+                    inRange = num.d >= static_cast<double>(std::numeric_limits<T>::min()) &&
+                              num.d < static_cast<double>(std::numeric_limits<T>::max()) + 1.0 &&
+                              std::floor(num.d) == num.d;
+                    value = inRange ? static_cast<T>(num.d) : T();
+                }
+                if (!inRange)
+                    throw(JsonException("parse type mismatch"));
+            }
+            else
+                value = static_cast<T>(reader.ReadNumber());
+        }
+        static void Write(std::string &out, T value)
+        {
+            if constexpr (std::is_integral_v<T>)
+                JsonFormat::AppendInteger(out, value);
+            else
+                JsonFormat::AppendNumber(out, static_cast<double>(value));
+        }
+    };
+
+    template <>
+    struct JsonCodec<std::string>
+    {
+        static void Read(JsonReader &reader, std::string &value)
+        {
+            ExpectJsonType(reader, JsonType::String);
+            reader.ReadString(value);
+        }
+        static void Write(std::string &out, const std::string &value)
+        {
+            JsonFormat::AppendString(out, value);
+        }
+    };
+
+    template <typename T>
+    struct JsonCodec<std::vector<T>>
+    {
+        static void Read(JsonReader &reader, std::vector<T> &value)
+        {
+            ExpectJsonType(reader, JsonType::Array);
+            value.clear();
+            if (!reader.BeginArray())
+                return;
+            do
+            {
+                // 先读到局部变量再放入：std::vector<bool> 的 back() 返回代理对象，不能绑定到 bool &
+                T item{};
+                JsonCodec<T>::Read(reader, item);
+                value.push_back(std::move(item));
+            } while (reader.NextArrayElement());
+        }
+        static void Write(std::string &out, const std::vector<T> &value)
+        {
+            out += '[';
+            for (size_t i = 0; i < value.size(); ++i)
+            {
+                if (i > 0)
+                    out += ',';
+                JsonCodec<T>::Write(out, value[i]);
+            }
+            out += ']';
+        }
+    };
+
+    template <typename T>
+    struct JsonCodec<std::optional<T>>
+    {
+        static void Read(JsonReader &reader, std::optional<T> &value)
+        {
+            if (reader.PeekType() == JsonType::Null)
+            {
+                reader.ReadNull();
+                value.reset();
+                return;
+            }
+            JsonCodec<T>::Read(reader, value.emplace());
+        }
+        static void Write(std::string &out, const std::optional<T> &value)
+        {
+            if (value)
+                JsonCodec<T>::Write(out, *value);
+            else
+                out += "null";
+        }
+    };
+
+    /* std::map、std::unordered_map 等以 std::string 为 key 的关联容器 */
+    template <typename Map>
+    struct JsonMapCodec
+    {
+        static void Read(JsonReader &reader, Map &value)
+        {
+            ExpectJsonType(reader, JsonType::Object);
+            value.clear();
+            std::string_view key;
+            if (!reader.BeginObject(key))
+                return;
+            do
+            {
+                auto &slot = value[std::string(key)];
+                JsonCodec<typename Map::mapped_type>::Read(reader, slot);
+            } while (reader.NextObjectMember(key));
+        }
+        static void Write(std::string &out, const Map &value)
+        {
+            out += '{';
+            bool first = true;
+            for (auto &m : value)
+            {
+                if (!first)
+                    out += ',';
+                first = false;
+                JsonFormat::AppendString(out, m.first);
+                out += ':';
+                JsonCodec<typename Map::mapped_type>::Write(out, m.second);
+            }
+            out += '}';
+        }
+    };
+    template <typename T>
+    struct JsonCodec<std::map<std::string, T>> : JsonMapCodec<std::map<std::string, T>>
+    {
+    };
+    template <typename T>
+    struct JsonCodec<std::unordered_map<std::string, T>> : JsonMapCodec<std::unordered_map<std::string, T>>
+    {
+    };
+
+    template <typename T>
+    struct JsonCodec<T, std::enable_if_t<IsJsonReflected<T>::value>>
+    {
+        static void Read(JsonReader &reader, T &value)
+        {
+            ExpectJsonType(reader, JsonType::Object);
+            constexpr size_t n = std::tuple_size_v<std::decay_t<decltype(JsonFieldsOf<T>)>>;
+            std::string_view key;
+            if (!reader.BeginObject(key))
+                return;
+            do
+            {
+                // 未知的 key 直接跳过它的值
+                if (!ReadField(reader, value, key, JsonKeyTag(key.data(), key.size()), std::make_index_sequence<n>{}))
+                    reader.SkipValue();
+            } while (reader.NextObjectMember(key));
+        }
+        static void Write(std::string &out, const T &value)
+        {
+            constexpr size_t n = std::tuple_size_v<std::decay_t<decltype(JsonFieldsOf<T>)>>;
+            out += '{';
+            WriteFields(out, value, std::make_index_sequence<n>{});
+            out += '}';
+        }
+
+    private:
+        /* 依次与每个字段比较，字段的标签都是编译期常量 */
+        template <size_t... I>
+        static bool ReadField(JsonReader &reader, T &value, std::string_view key, uint64_t tag,
+                              std::index_sequence<I...>)
+        {
+            return ((std::get<I>(JsonFieldsOf<T>).Match(key, tag)
+                         ? (ReadMember(reader, value.*(std::get<I>(JsonFieldsOf<T>).member)), true)
+                         : false) ||
+                    ...);
+        }
+        template <typename M>
+        static void ReadMember(JsonReader &reader, M &member)
+        {
+            JsonCodec<M>::Read(reader, member);
+        }
+        template <size_t... I>
+        static void WriteFields(std::string &out, const T &value, std::index_sequence<I...>)
+        {
+            (WriteField<I>(out, value), ...);
+        }
+        template <size_t I>
+        static void WriteField(std::string &out, const T &value)
+        {
+            // key 是编译期拼好的字面量，第一个字段跳过前导逗号
+            const auto &f = std::get<I>(JsonFieldsOf<T>);
+            if constexpr (I == 0)
+                out.append(f.quoted + 1, f.len + 3);
+            else
+                out.append(f.quoted, f.len + 4);
+            WriteMember(out, value.*(f.member));
+        }
+        template <typename M>
+        static void WriteMember(std::string &out, const M &member)
+        {
+            JsonCodec<M>::Write(out, member);
+        }
+    };
+
+    /* 把 json 字符串直接解析到结构体中 */
+    template <typename T>
+    void ParseStruct(const std::string &content, T &value)
+    {
+        JsonReader reader(content);
+        JsonCodec<T>::Read(reader, value);
+        reader.Finish();
+    }
+
+    template <typename T>
+    void ParseStruct(const std::string &content, T &value, std::string &status) noexcept
+    {
+        try
+        {
+            ParseStruct(content, value);
+            status = "parse ok";
+        }
+        catch (const JsonException &msg)
+        {
+            status = msg.what();
+        }
+        catch (...)
+        {
+            // 内存不足等非解析错误，不能留下上一次的状态
+            try
+            {
+                status = JsonStatus::Message(JsonStatus::Unknown);
+            }
+            catch (...)
+            {
+                status.clear();
+            }
+        }
+    }
+
+    /* 把结构体直接生成为 json 字符串 */
+    template <typename T>
+    void StringifyStruct(const T &value, std::string &content)
+    {
+        content.clear();
+        JsonCodec<T>::Write(content, value);
+    }
+}
+#endif // JSONREFLECT_H
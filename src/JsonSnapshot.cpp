@@ -0,0 +1,659 @@
+#include <assert.h>
+#include <string.h>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include "JsonSnapshot.h"
+#include "JsonValue.h"
+#include "JsonException.h"
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SJson
+{
+    namespace
+    {
+        const char kMagic[4] = {'S', 'J', 'S', 'B'};
+        const uint32_t kVersion = 1;
+        /* 头部：magic、版本、总大小、根节点偏移、key 数量、key 表偏移 */
+        const uint32_t kHeaderSize = 24;
+
+        inline uint32_t LoadU32(const char *data, uint64_t off) noexcept
+        {
+            uint32_t v;
+            memcpy(&v, data + off, sizeof(v));
+            return v;
+        }
+
+        /* 遍历 key 表和从根可达的所有节点，所有计算用 64 位，不会回绕；
+           写入是后序的，子节点的偏移必然小于父节点，因此不会有环，每个节点只检查一次 */
+        bool VerifySnapshot(const char *data, uint64_t total, uint32_t root, uint32_t keyCount, uint32_t keyTable)
+        {
+            for (uint64_t id = 0; id < keyCount; ++id)
+            {
+                uint64_t off = LoadU32(data, keyTable + id * 4);
+                if (off < kHeaderSize || off + 4 > total)
+                    return false;
+                uint64_t end = off + 4 + LoadU32(data, off);
+                if (end >= total || data[end] != '\0')
+                    return false;
+            }
+            std::vector<bool> visited(total / 8 + 1, false);
+            std::vector<uint32_t> pending(1, root);
+            while (!pending.empty())
+            {
+                uint64_t off = pending.back();
+                pending.pop_back();
+                if (off % 8 != 0 || off < kHeaderSize || off + 8 > total)
+                    return false;
+                if (visited[off / 8])
+                    continue;
+                visited[off / 8] = true;
+                uint32_t type = LoadU32(data, off);
+                uint64_t count = LoadU32(data, off + 4);
+                switch (type)
+                {
+                case JsonType::Null:
+                case JsonType::True:
+                case JsonType::False:
+                    break;
+                case JsonType::Number:
+                    if (count > JsonNumberKind::Uint64 || off + 16 > total)
+                        return false;
+                    break;
+                case JsonType::String:
+                    if (off + 8 + count >= total || data[off + 8 + count] != '\0')
+                        return false;
+                    break;
+                case JsonType::Array:
+                    if (off + 8 + count * 4 > total)
+                        return false;
+                    for (uint64_t i = 0; i < count; ++i)
+                    {
+                        uint32_t child = LoadU32(data, off + 8 + i * 4);
+                        if (child >= off)
+                            return false;
+                        pending.push_back(child);
+                    }
+                    break;
+                case JsonType::Object:
+                    if (off + 8 + count * 8 > total)
+                        return false;
+                    for (uint64_t i = 0; i < count; ++i)
+                    {
+                        uint32_t child = LoadU32(data, off + 12 + i * 8);
+                        if (LoadU32(data, off + 8 + i * 8) >= keyCount || child >= off)
+                            return false;
+                        pending.push_back(child);
+                    }
+                    break;
+                default:
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        class SnapshotWriter
+        {
+        public:
+            explicit SnapshotWriter(std::string &out) : m_out(out) {}
+
+            void Write(const JsonValue &root)
+            {
+                m_out.assign(kHeaderSize, '\0');
+                uint32_t rootOff = WriteValue(root);
+
+                // key 字典放在所有节点之后：先写 key 字符串，再写偏移表
+                std::vector<uint32_t> keyOffs;
+                keyOffs.reserve(m_keys.size());
+                for (auto &key : m_keys)
+                {
+                    keyOffs.push_back(Align());
+                    PutU32(static_cast<uint32_t>(key.size()));
+                    m_out.append(key);
+                    m_out += '\0';
+                }
+                uint32_t keyTable = Align();
+                for (auto off : keyOffs)
+                    PutU32(off);
+                Align();
+
+                if (m_out.size() > UINT32_MAX)
+                    throw(JsonException("snapshot too big"));
+                memcpy(&m_out[0], kMagic, 4);
+                SetU32(4, kVersion);
+                SetU32(8, static_cast<uint32_t>(m_out.size()));
+                SetU32(12, rootOff);
+                SetU32(16, static_cast<uint32_t>(m_keys.size()));
+                SetU32(20, keyTable);
+            }
+
+        private:
+            /* 后序写入：先写子节点，父节点才能记录子节点的偏移；用显式的栈代替递归，深层嵌套也不会栈溢出 */
+            uint32_t WriteValue(const JsonValue &root)
+            {
+                // 每一层尚未写完的数组或对象，子节点的偏移（对象还有 key 编号）依次压在 m_slots 上
+                struct Frame
+                {
+                    const JsonValue *val;
+                    size_t index;
+                    size_t base;
+                };
+                std::vector<Frame> frames;
+                const JsonValue *val = &root;
+                for (;;)
+                {
+                    uint32_t off;
+                    int type = val->GetType();
+                    if (type == JsonType::Array || type == JsonType::Object)
+                    {
+                        frames.push_back(Frame{val, 0, m_slots.size()});
+                        off = 0;
+                    }
+                    else
+                        off = WriteScalar(*val);
+
+                    for (;;)
+                    {
+                        if (frames.empty())
+                            return off;
+                        Frame &f = frames.back();
+                        bool isArray = f.val->GetType() == JsonType::Array;
+                        size_t n = isArray ? f.val->GetArraySize() : f.val->GetObjectSize();
+                        // 刚写完的子节点（容器刚入栈时没有）
+                        if (off != 0)
+                            m_slots.push_back(off);
+                        if (f.index < n)
+                        {
+                            size_t i = f.index++;
+                            if (isArray)
+                                val = &f.val->GetArrayElement(i);
+                            else
+                            {
+                                m_slots.push_back(KeyId(f.val->GetObjectKey(i)));
+                                val = &f.val->GetObjectValue(i);
+                            }
+                            break;
+                        }
+                        // 子节点都已写完，写容器本身
+                        off = PutHeader(isArray ? JsonType::Array : JsonType::Object, n);
+                        for (size_t k = f.base; k < m_slots.size(); ++k)
+                            PutU32(m_slots[k]);
+                        m_slots.resize(f.base);
+                        frames.pop_back();
+                    }
+                }
+            }
+
+            uint32_t WriteScalar(const JsonValue &val)
+            {
+                switch (val.GetType())
+                {
+                case JsonType::Number:
+                {
+                    // 数量字段记录数字的表示，负载为对应表示的 8 个字节
+                    int kind = val.GetNumberKind();
+                    uint32_t off = PutHeader(JsonType::Number, kind);
+                    if (kind == JsonNumberKind::Int64)
+                    {
+                        int64_t i = val.GetInt64();
+                        m_out.append(reinterpret_cast<const char *>(&i), sizeof(i));
+                    }
+                    else if (kind == JsonNumberKind::Uint64)
+                    {
+                        uint64_t u = val.GetUint64();
+                        m_out.append(reinterpret_cast<const char *>(&u), sizeof(u));
+                    }
+                    else
+                    {
+                        double d = val.GetNumber();
+                        m_out.append(reinterpret_cast<const char *>(&d), sizeof(d));
+                    }
+                    return off;
+                }
+                case JsonType::String:
+                {
+                    const std::string &s = val.GetString();
+                    uint32_t off = PutHeader(JsonType::String, s.size());
+                    m_out.append(s);
+                    m_out += '\0';
+                    return off;
+                }
+                default:
+                    return PutHeader(static_cast<JsonType::type>(val.GetType()), 0);
+                }
+            }
+
+            uint32_t KeyId(const std::string &key)
+            {
+                auto it = m_keyIds.find(key);
+                if (it != m_keyIds.end())
+                    return it->second;
+                uint32_t id = static_cast<uint32_t>(m_keys.size());
+                m_keys.push_back(key);
+                m_keyIds.emplace(key, id);
+                return id;
+            }
+
+            uint32_t PutHeader(JsonType::type t, size_t count)
+            {
+                if (count > UINT32_MAX)
+                    throw(JsonException("snapshot too big"));
+                uint32_t off = Align();
+                PutU32(static_cast<uint32_t>(t));
+                PutU32(static_cast<uint32_t>(count));
+                return off;
+            }
+
+            uint32_t Align()
+            {
+                m_out.resize((m_out.size() + 7) & ~static_cast<size_t>(7), '\0');
+                if (m_out.size() > UINT32_MAX)
+                    throw(JsonException("snapshot too big"));
+                return static_cast<uint32_t>(m_out.size());
+            }
+
+            void PutU32(uint32_t v)
+            {
+                m_out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+            }
+
+            void SetU32(size_t pos, uint32_t v)
+            {
+                memcpy(&m_out[pos], &v, sizeof(v));
+            }
+
+            std::string &m_out;
+            std::vector<std::string> m_keys;
+            std::unordered_map<std::string, uint32_t> m_keyIds;
+            std::vector<uint32_t> m_slots;
+        };
+    }
+
+    uint32_t JsonSnapshotView::ReadU32(uint32_t off) const noexcept
+    {
+        uint32_t v;
+        memcpy(&v, m_base + off, sizeof(v));
+        return v;
+    }
+
+    std::string_view JsonSnapshotView::ReadKey(uint32_t id) const noexcept
+    {
+        uint32_t keyTable = ReadU32(20);
+        assert(id < ReadU32(16));
+        uint32_t off = ReadU32(keyTable + id * 4);
+        return std::string_view(m_base + off + 4, ReadU32(off));
+    }
+
+    int JsonSnapshotView::GetType() const noexcept
+    {
+        if (m_base == nullptr)
+            return JsonType::Null;
+        return static_cast<int>(ReadU32(m_off));
+    }
+
+    double JsonSnapshotView::GetNumber() const noexcept
+    {
+        assert(GetType() == JsonType::Number);
+        JsonValue val;
+        LoadNumber(val);
+        return val.GetNumber();
+    }
+
+    int JsonSnapshotView::GetNumberKind() const noexcept
+    {
+        assert(GetType() == JsonType::Number);
+        return static_cast<int>(ReadU32(m_off + 4));
+    }
+
+    void JsonSnapshotView::LoadNumber(JsonValue &val) const noexcept
+    {
+        switch (GetNumberKind())
+        {
+        case JsonNumberKind::Int64:
+        {
+            int64_t i;
+            memcpy(&i, m_base + m_off + 8, sizeof(i));
+            val.SetInt64(i);
+            break;
+        }
+        case JsonNumberKind::Uint64:
+        {
+            uint64_t u;
+            memcpy(&u, m_base + m_off + 8, sizeof(u));
+            val.SetUint64(u);
+            break;
+        }
+        default:
+        {
+            double d;
+            memcpy(&d, m_base + m_off + 8, sizeof(d));
+            val.SetNumber(d);
+            break;
+        }
+        }
+    }
+
+    int64_t JsonSnapshotView::GetInt64() const noexcept
+    {
+        // 与 JsonValue 的转换规则相同
+        JsonValue val;
+        LoadNumber(val);
+        return val.GetInt64();
+    }
+
+    uint64_t JsonSnapshotView::GetUint64() const noexcept
+    {
+        JsonValue val;
+        LoadNumber(val);
+        return val.GetUint64();
+    }
+
+    std::string_view JsonSnapshotView::GetString() const noexcept
+    {
+        assert(GetType() == JsonType::String);
+        return std::string_view(m_base + m_off + 8, ReadU32(m_off + 4));
+    }
+
+    size_t JsonSnapshotView::GetArraySize() const noexcept
+    {
+        assert(GetType() == JsonType::Array);
+        return ReadU32(m_off + 4);
+    }
+
+    JsonSnapshotView JsonSnapshotView::GetArrayElement(size_t index) const noexcept
+    {
+        assert(index < GetArraySize());
+        return JsonSnapshotView(m_base, ReadU32(m_off + 8 + static_cast<uint32_t>(index) * 4));
+    }
+
+    size_t JsonSnapshotView::GetObjectSize() const noexcept
+    {
+        assert(GetType() == JsonType::Object);
+        return ReadU32(m_off + 4);
+    }
+
+    std::string_view JsonSnapshotView::GetObjectKey(size_t index) const noexcept
+    {
+        assert(index < GetObjectSize());
+        return ReadKey(ReadU32(m_off + 8 + static_cast<uint32_t>(index) * 8));
+    }
+
+    size_t JsonSnapshotView::GetObjectKeyLength(size_t index) const noexcept
+    {
+        return GetObjectKey(index).size();
+    }
+
+    JsonSnapshotView JsonSnapshotView::GetObjectValue(size_t index) const noexcept
+    {
+        assert(index < GetObjectSize());
+        return JsonSnapshotView(m_base, ReadU32(m_off + 12 + static_cast<uint32_t>(index) * 8));
+    }
+
+    long long JsonSnapshotView::FindObjectIndex(std::string_view key) const noexcept
+    {
+        for (size_t i = 0, n = GetObjectSize(); i < n; ++i)
+        {
+            if (GetObjectKey(i) == key)
+                return i;
+        }
+        return -1;
+    }
+
+    void JsonSnapshotView::ScalarToJson(Json &json) const noexcept
+    {
+        switch (GetType())
+        {
+        case JsonType::Null:
+            json.SetNull();
+            break;
+        case JsonType::True:
+            json.SetBoolean(true);
+            break;
+        case JsonType::False:
+            json.SetBoolean(false);
+            break;
+        case JsonType::Number:
+        {
+            JsonValue val;
+            LoadNumber(val);
+            if (val.GetNumberKind() == JsonNumberKind::Int64)
+                json.SetInt64(val.GetInt64());
+            else if (val.GetNumberKind() == JsonNumberKind::Uint64)
+                json.SetUint64(val.GetUint64());
+            else
+                json.SetNumber(val.GetNumber());
+            break;
+        }
+        case JsonType::String:
+            json.SetString(std::string(GetString()));
+            break;
+        default:
+            assert(0 && "invalid type");
+        }
+    }
+
+    void JsonSnapshotView::ToJson(Json &json) const noexcept
+    {
+        // 用显式的栈代替递归：每一层尚未还原完的数组或对象，子节点还原后移入 value
+        struct Frame
+        {
+            JsonSnapshotView view;
+            size_t index;
+            Json value;
+        };
+        std::vector<Frame> frames;
+        JsonSnapshotView cur = *this;
+        Json done;
+        for (;;)
+        {
+            int type = cur.GetType();
+            if (type == JsonType::Array || type == JsonType::Object)
+            {
+                frames.push_back(Frame{cur, 0, Json()});
+                if (type == JsonType::Array)
+                    frames.back().value.SetArray();
+                else
+                    frames.back().value.SetObject();
+            }
+            else
+                cur.ScalarToJson(done);
+
+            for (;;)
+            {
+                if (frames.empty())
+                {
+                    json = std::move(done);
+                    return;
+                }
+                Frame &f = frames.back();
+                bool isArray = f.view.GetType() == JsonType::Array;
+                // 回到 index 大于 0 的一层时，第 index - 1 个子节点刚刚还原完（容器刚入栈时没有）
+                if (f.index > 0)
+                {
+                    if (isArray)
+                        f.value.PushbackArrayElement(std::move(done));
+                    else
+                        f.value.SetObjectValue(std::string(f.view.GetObjectKey(f.index - 1)), std::move(done));
+                }
+                size_t n = isArray ? f.view.GetArraySize() : f.view.GetObjectSize();
+                if (f.index < n)
+                {
+                    cur = isArray ? f.view.GetArrayElement(f.index) : f.view.GetObjectValue(f.index);
+                    ++f.index;
+                    break;
+                }
+                done = std::move(f.value);
+                frames.pop_back();
+            }
+        }
+    }
+
+    JsonSnapshot::~JsonSnapshot() noexcept
+    {
+        Close();
+    }
+
+    JsonSnapshot::JsonSnapshot(JsonSnapshot &&rhs) noexcept
+    {
+        *this = std::move(rhs);
+    }
+
+    JsonSnapshot &JsonSnapshot::operator=(JsonSnapshot &&rhs) noexcept
+    {
+        if (this == &rhs)
+            return *this;
+        Close();
+        m_buffer.swap(rhs.m_buffer);
+        m_data = m_buffer.empty() ? rhs.m_data : m_buffer.data();
+        m_size = rhs.m_size;
+        m_root = rhs.m_root;
+        m_mapping = rhs.m_mapping;
+        m_mappingSize = rhs.m_mappingSize;
+        m_verify = rhs.m_verify;
+        rhs.m_data = nullptr;
+        rhs.m_size = 0;
+        rhs.m_root = 0;
+        rhs.m_mapping = nullptr;
+        rhs.m_mappingSize = 0;
+        return *this;
+    }
+
+    void JsonSnapshot::Write(const Json &json, std::string &out)
+    {
+        SnapshotWriter(out).Write(json.Value());
+    }
+
+    void JsonSnapshot::WriteFile(const Json &json, const std::string &path)
+    {
+        std::string out;
+        Write(json, out);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.write(out.data(), out.size()))
+            throw(JsonException("snapshot write failed"));
+    }
+
+    void JsonSnapshot::Load(const char *data, size_t size)
+    {
+        Close();
+        // 头部的范围检查用 64 位计算，不会回绕；节点按 m_verify 决定是否在加载时全部校验
+        uint32_t version, total, root, keyCount, keyTable;
+        if (data == nullptr || size < kHeaderSize || memcmp(data, kMagic, 4) != 0)
+            throw(JsonException("snapshot invalid header"));
+        memcpy(&version, data + 4, 4);
+        memcpy(&total, data + 8, 4);
+        memcpy(&root, data + 12, 4);
+        memcpy(&keyCount, data + 16, 4);
+        memcpy(&keyTable, data + 20, 4);
+        if (version != kVersion)
+            throw(JsonException("snapshot version mismatch"));
+        if (total > size || total < kHeaderSize || root < kHeaderSize || uint64_t(root) + 8 > total ||
+            keyTable < kHeaderSize || uint64_t(keyTable) + uint64_t(keyCount) * 4 > total)
+            throw(JsonException("snapshot invalid header"));
+        if (m_verify && !VerifySnapshot(data, total, root, keyCount, keyTable))
+            throw(JsonException("snapshot corrupt"));
+        m_data = data;
+        m_size = total;
+        m_root = root;
+    }
+
+    void JsonSnapshot::Load(const char *data, size_t size, std::string &status) noexcept
+    {
+        try
+        {
+            Load(data, size);
+            status = "load ok";
+        }
+        catch (const JsonException &msg)
+        {
+            status = msg.what();
+        }
+    }
+
+    void JsonSnapshot::Map(const std::string &path)
+    {
+        Close();
+#ifdef _WIN32
+        // Windows 下退化为一次性读入内存
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw(JsonException("snapshot open failed"));
+        std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        Load(buffer.data(), buffer.size());
+        m_buffer.swap(buffer);
+        m_data = m_buffer.data();
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw(JsonException("snapshot open failed"));
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            close(fd);
+            throw(JsonException("snapshot invalid header"));
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED)
+            throw(JsonException("snapshot map failed"));
+        try
+        {
+            Load(static_cast<const char *>(addr), size);
+        }
+        catch (const JsonException &)
+        {
+            munmap(addr, size);
+            throw;
+        }
+        m_mapping = addr;
+        m_mappingSize = size;
+#endif
+    }
+
+    void JsonSnapshot::Map(const std::string &path, std::string &status) noexcept
+    {
+        try
+        {
+            Map(path);
+            status = "load ok";
+        }
+        catch (const JsonException &msg)
+        {
+            status = msg.what();
+        }
+    }
+
+    void JsonSnapshot::Close() noexcept
+    {
+#ifndef _WIN32
+        if (m_mapping != nullptr)
+            munmap(m_mapping, m_mappingSize);
+#endif
+        m_mapping = nullptr;
+        m_mappingSize = 0;
+        m_buffer.clear();
+        m_data = nullptr;
+        m_size = 0;
+        m_root = 0;
+    }
+
+    void JsonSnapshot::SetVerify(bool verify) noexcept
+    {
+        m_verify = verify;
+    }
+
+    JsonSnapshotView JsonSnapshot::GetRoot() const noexcept
+    {
+        if (m_data == nullptr)
+            return JsonSnapshotView();
+        return JsonSnapshotView(m_data, m_root);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef JSONSNAPSHOT_H
+#define JSONSNAPSHOT_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Json.h"
+
+namespace SJson
+{
+    /*
+     * 二进制快照格式（位置无关，所有偏移量都相对于缓冲区起始位置，节点按 8 字节对齐）：
+     *   头部：  "SJSB" | 版本 | 总大小 | 根节点偏移 | key 数量 | key 表偏移
+     *   节点：  uint32 类型 | uint32 数量（字符串长度 / 数组元素个数 / 对象成员个数）| 负载
+     *           number 的数量字段记录 JsonNumberKind，负载为 8 字节对齐的 double / int64 / uint64；string 负载为字节串加 '\0'；
+     *           array 负载为子节点偏移数组；object 负载为 (key 编号, 值偏移) 数组
+     *   key 表：去重后的 key 字典，每一项指向 uint32 长度 | 字节串 | '\0'
+     */
+    class JsonSnapshotView
+    {
+    public:
+        JsonSnapshotView() noexcept : m_base(nullptr), m_off(0) {}
+
+        /* 与 Json 的访问器保持一致，但字符串直接返回指向快照内部的视图 */
+        int GetType() const noexcept;
+        double GetNumber() const noexcept;
+        int GetNumberKind() const noexcept;
+        int64_t GetInt64() const noexcept;
+        uint64_t GetUint64() const noexcept;
+        std::string_view GetString() const noexcept;
+
+        size_t GetArraySize() const noexcept;
+        JsonSnapshotView GetArrayElement(size_t index) const noexcept;
+
+        size_t GetObjectSize() const noexcept;
+        std::string_view GetObjectKey(size_t index) const noexcept;
+        size_t GetObjectKeyLength(size_t index) const noexcept;
+        JsonSnapshotView GetObjectValue(size_t index) const noexcept;
+        long long FindObjectIndex(std::string_view key) const noexcept;
+
+        /* 把快照中的子树还原为可修改的 Json */
+        void ToJson(Json &json) const noexcept;
+
+    private:
+        JsonSnapshotView(const char *base, uint32_t off) noexcept : m_base(base), m_off(off) {}
+        uint32_t ReadU32(uint32_t off) const noexcept;
+        std::string_view ReadKey(uint32_t id) const noexcept;
+        void LoadNumber(JsonValue &val) const noexcept;
+        /* 还原 null、true、false、数字、字符串 */
+        void ScalarToJson(Json &json) const noexcept;
+        const char *m_base;
+        uint32_t m_off;
+        friend class JsonSnapshot;
+    };
+
+    class JsonSnapshot
+    {
+    public:
+        JsonSnapshot() noexcept = default;
+        ~JsonSnapshot() noexcept;
+        JsonSnapshot(const JsonSnapshot &) = delete;
+        JsonSnapshot &operator=(const JsonSnapshot &) = delete;
+        JsonSnapshot(JsonSnapshot &&rhs) noexcept;
+        JsonSnapshot &operator=(JsonSnapshot &&rhs) noexcept;
+
+        /* 把 Json 写成快照格式 */
+        static void Write(const Json &json, std::string &out);
+        static void WriteFile(const Json &json, const std::string &path);
+
+        /* 在已有的缓冲区上加载快照，缓冲区的生命周期由调用者保证；
+           默认遍历一次节点表，校验所有偏移、长度与类型，损坏的快照报 "snapshot corrupt" */
+        void Load(const char *data, size_t size);
+        void Load(const char *data, size_t size, std::string &status) noexcept;
+        /* 以只读共享方式映射快照文件，多个进程映射同一文件时共享物理页 */
+        void Map(const std::string &path);
+        void Map(const std::string &path, std::string &status) noexcept;
+        void Close() noexcept;
+        /* 关闭后 Load、Map 只检查头部，耗时 O(1)，只能用于可信的快照（例如本进程刚写出的文件） */
+        void SetVerify(bool verify) noexcept;
+
+        JsonSnapshotView GetRoot() const noexcept;
+
+    private:
+        const char *m_data = nullptr;
+        size_t m_size = 0;
+        uint32_t m_root = 0;
+        /* Map 得到的映射区域，Load 时为空 */
+        void *m_mapping = nullptr;
+        size_t m_mappingSize = 0;
+        std::string m_buffer;
+        bool m_verify = true;
+    };
+}
+#endif // JSONSNAPSHOT_H
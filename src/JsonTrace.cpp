@@ -0,0 +1,101 @@
+#include "JsonTrace.h"
+#include <chrono>
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SJSON_HAS_USDT 1
+#endif
+#endif
+
+/* 没有 USDT 时作为 uprobe 的挂载点：不内联，函数体保留一条屏障，避免被优化掉 */
+extern "C"
+#if defined(_MSC_VER)
+    __declspec(noinline)
+#else
+    __attribute__((noinline, used))
+#endif
+    void sjson_trace_probe(int phase, uint64_t bytes, uint64_t cycles) noexcept
+{
+    (void)phase;
+    (void)bytes;
+    (void)cycles;
+#if !defined(_MSC_VER)
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+namespace SJson
+{
+    namespace
+    {
+        const char *const kPhaseNames[JsonProfile::PhaseCount] = {
+            "whitespace", "literal", "number", "string", "container", "allocation", "total"};
+    }
+
+    void JsonProfile::Reset() noexcept
+    {
+        *this = JsonProfile();
+    }
+
+    std::string JsonProfile::Summary() const
+    {
+        if (!enabled)
+            return "trace disabled (build with SJSON_TRACE)\n";
+        std::string res;
+        char line[128];
+        for (int i = 0; i < PhaseCount; ++i)
+        {
+            const JsonPhaseCounters &c = phases[i];
+            snprintf(line, sizeof(line), "%-10s calls=%llu bytes=%llu cycles=%llu\n", kPhaseNames[i],
+                     (unsigned long long)c.calls, (unsigned long long)c.bytes, (unsigned long long)c.cycles);
+            res += line;
+        }
+        return res;
+    }
+
+    namespace JsonTrace
+    {
+        uint64_t Now() noexcept
+        {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+            return __rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+#endif
+        }
+
+        void Probe(int phase, uint64_t bytes, uint64_t cycles) noexcept
+        {
+#ifdef SJSON_HAS_USDT
+            DTRACE_PROBE3(sjson, phase, phase, bytes, cycles);
+#else
+            sjson_trace_probe(phase, bytes, cycles);
+#endif
+        }
+    }
+
+    JsonTraceScope::~JsonTraceScope() noexcept
+    {
+        uint64_t cycles = JsonTrace::Now() - m_time;
+        uint64_t bytes;
+        if (m_cur != nullptr)
+            bytes = reinterpret_cast<uintptr_t>(*m_cur) - m_start;
+        else if (m_out != nullptr)
+            bytes = m_out->size() - m_start;
+        else
+            bytes = m_start;
+        JsonPhaseCounters &c = m_profile.phases[m_phase];
+        c.cycles += cycles;
+        c.bytes += bytes;
+        ++c.calls;
+        JsonTrace::Probe(m_phase, bytes, cycles);
+    }
+}
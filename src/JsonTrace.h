@@ -0,0 +1,87 @@
+#ifndef JSONTRACE_H
+#define JSONTRACE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace SJson
+{
+    /* 每个阶段的计数：耗时（时钟周期，非 x86 平台为纳秒）、处理的字节数、调用次数 */
+    struct JsonPhaseCounters
+    {
+        uint64_t cycles = 0;
+        uint64_t bytes = 0;
+        uint64_t calls = 0;
+    };
+
+    /*
+     * 解析、生成的分阶段统计。只有定义了 SJSON_TRACE（CMake 选项 SJSON_TRACE=ON）时才会插桩，
+     * 否则插桩宏展开为空，enabled 为 false，所有计数保持为 0。
+     * 阶段之间是包含关系，例如解析对象 key 的耗时也计入 String，Total 为整次调用。
+     */
+    struct JsonProfile
+    {
+        enum Phase
+        {
+            Whitespace,
+            Literal,
+            Number,
+            String,
+            Container,
+            Allocation,
+            Total,
+            PhaseCount
+        };
+        JsonPhaseCounters phases[PhaseCount];
+        bool enabled = false;
+
+        void Reset() noexcept;
+        /* 可读的摘要，每个阶段一行 */
+        std::string Summary() const;
+    };
+
+    namespace JsonTrace
+    {
+        /* 读取时钟：x86 上为 rdtsc，其他平台为单调时钟的纳秒数 */
+        uint64_t Now() noexcept;
+        /* 每个阶段结束时调用的探针：有 <sys/sdt.h> 时是 USDT 探针 sjson:phase，否则是可用 uprobe 挂载的函数 sjson_trace_probe */
+        void Probe(int phase, uint64_t bytes, uint64_t cycles) noexcept;
+    }
+
+    /* 作用域计时：析构时累加到对应阶段，字节数取游标的移动距离、输出的增长量或固定值 */
+    class JsonTraceScope
+    {
+    public:
+        JsonTraceScope(JsonProfile &profile, JsonProfile::Phase phase, const char *const &cur) noexcept
+            : m_profile(profile), m_phase(phase), m_cur(&cur), m_out(nullptr), m_start(reinterpret_cast<uintptr_t>(cur)), m_time(JsonTrace::Now()) {}
+        JsonTraceScope(JsonProfile &profile, JsonProfile::Phase phase, const std::string &out) noexcept
+            : m_profile(profile), m_phase(phase), m_cur(nullptr), m_out(&out), m_start(out.size()), m_time(JsonTrace::Now()) {}
+        JsonTraceScope(JsonProfile &profile, JsonProfile::Phase phase, size_t bytes) noexcept
+            : m_profile(profile), m_phase(phase), m_cur(nullptr), m_out(nullptr), m_start(bytes), m_time(JsonTrace::Now()) {}
+        ~JsonTraceScope() noexcept;
+        JsonTraceScope(const JsonTraceScope &) = delete;
+        JsonTraceScope &operator=(const JsonTraceScope &) = delete;
+
+    private:
+        JsonProfile &m_profile;
+        JsonProfile::Phase m_phase;
+        const char *const *m_cur;
+        const std::string *m_out;
+        uintptr_t m_start;
+        uint64_t m_time;
+    };
+}
+
+#define SJSON_TRACE_CONCAT_(a, b) a##b
+#define SJSON_TRACE_CONCAT(a, b) SJSON_TRACE_CONCAT_(a, b)
+#ifdef SJSON_TRACE
+/* 在当前作用域内统计 phase 阶段；pos 为输入游标、输出字符串或固定的字节数 */
+#define SJSON_TRACE_SCOPE(profile, phase, pos) \
+    ::SJson::JsonTraceScope SJSON_TRACE_CONCAT(sjsonTrace, __LINE__)(profile, ::SJson::JsonProfile::phase, pos)
+#define SJSON_TRACE_RESET(profile) ((profile).Reset(), (profile).enabled = true)
+#else
+#define SJSON_TRACE_SCOPE(profile, phase, pos) ((void)0)
+#define SJSON_TRACE_RESET(profile) ((void)0)
+#endif
+
+#endif // JSONTRACE_H
@@ -0,0 +1,236 @@
+#include "JsonUtf8.h"
+#include <cstdint>
+#include <cstring>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SJSON_UTF8_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+namespace SJson
+{
+    namespace JsonUtf8
+    {
+        namespace
+        {
+            /* 逐字节检查，从字符边界 pos 开始，返回第一个非法序列首字节的偏移，合法时返回 size */
+            size_t ValidateScalar(const unsigned char *s, size_t pos, size_t size) noexcept
+            {
+                while (pos < size)
+                {
+                    // 一次跳过 8 个 ascii 字节
+                    if (size - pos >= 8)
+                    {
+                        uint64_t word;
+                        memcpy(&word, s + pos, sizeof(word));
+                        if ((word & 0x8080808080808080ull) == 0)
+                        {
+                            pos += 8;
+                            continue;
+                        }
+                    }
+                    if (s[pos] < 0x80)
+                    {
+                        ++pos;
+                        continue;
+                    }
+                    unsigned u;
+                    size_t n = Decode(reinterpret_cast<const char *>(s + pos), size - pos, u);
+                    if (n == 0)
+                        return pos;
+                    pos += n;
+                }
+                return size;
+            }
+
+            /* 向量化检查在 i 之前的块中没有发现错误时，[0, i) 中只有最后一个字符可能不完整，退回到它的首字节 */
+            size_t LastBoundary(const unsigned char *s, size_t i) noexcept
+            {
+                size_t b = i;
+                for (size_t k = 1; k <= 4 && k <= i; ++k)
+                {
+                    b = i - k;
+                    if ((s[b] & 0xC0) != 0x80)
+                        break;
+                }
+                return b;
+            }
+
+#ifdef SJSON_UTF8_SSSE3
+            /* 查表法中的错误位：前一个字节的高、低半字节与当前字节的高半字节各查一张表，三者相与不为 0 即出错 */
+            enum : unsigned char
+            {
+                TooShort = 1 << 0,     // 首字节之后不是后续字节
+                TooLong = 1 << 1,      // ascii 之后是后续字节
+                Overlong3 = 1 << 2,    // 11100000 100_____
+                TooLarge = 1 << 3,     // 11110100 1001____ 及更大
+                Surrogate = 1 << 4,    // 11101101 101_____
+                Overlong2 = 1 << 5,    // 1100000_ 10______
+                TooLarge1000 = 1 << 6, // 11110101 1000____ 及更大
+                Overlong4 = 1 << 6,    // 11110000 1000____
+                TwoConts = 1 << 7,     // 10______ 10______
+                Carry = TooShort | TooLong | TwoConts
+            };
+
+            SJSON_UTF8_SSSE3 inline __m128i CheckBlock(__m128i input, __m128i prevInput) noexcept
+            {
+                const __m128i low4 = _mm_set1_epi8(0x0F);
+                const __m128i byte1HighTable = _mm_setr_epi8(
+                    // 0_______ ________
+                    TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+                    // 10______ ________
+                    char(TwoConts), char(TwoConts), char(TwoConts), char(TwoConts),
+                    // 1100____ ________
+                    TooShort | Overlong2,
+                    // 1101____ ________
+                    TooShort,
+                    // 1110____ ________
+                    TooShort | Overlong3 | Surrogate,
+                    // 1111____ ________
+                    TooShort | TooLarge | TooLarge1000 | Overlong4);
+                const __m128i byte1LowTable = _mm_setr_epi8(
+                    // ____0000 ________
+                    char(Carry | Overlong3 | Overlong2 | Overlong4),
+                    // ____0001 ________
+                    char(Carry | Overlong2),
+                    // ____001_ ________
+                    char(Carry), char(Carry),
+                    // ____0100 ________
+                    char(Carry | TooLarge),
+                    // ____0101 ________ 至 ____1111 ________，其中 ____1101 还可能是代理项
+                    char(Carry | TooLarge | TooLarge1000), char(Carry | TooLarge | TooLarge1000),
+                    char(Carry | TooLarge | TooLarge1000), char(Carry | TooLarge | TooLarge1000),
+                    char(Carry | TooLarge | TooLarge1000), char(Carry | TooLarge | TooLarge1000),
+                    char(Carry | TooLarge | TooLarge1000), char(Carry | TooLarge | TooLarge1000),
+                    char(Carry | TooLarge | TooLarge1000 | Surrogate),
+                    char(Carry | TooLarge | TooLarge1000), char(Carry | TooLarge | TooLarge1000));
+                const __m128i byte2HighTable = _mm_setr_epi8(
+                    // ________ 0_______
+                    TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+                    // ________ 1000____
+                    char(TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4),
+                    // ________ 1001____
+                    char(TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge),
+                    // ________ 101_____
+                    char(TooLong | Overlong2 | TwoConts | Surrogate | TooLarge),
+                    char(TooLong | Overlong2 | TwoConts | Surrogate | TooLarge),
+                    // ________ 11______
+                    TooShort, TooShort, TooShort, TooShort);
+
+                __m128i prev1 = _mm_alignr_epi8(input, prevInput, 15);
+                __m128i byte1High = _mm_shuffle_epi8(byte1HighTable, _mm_and_si128(_mm_srli_epi16(prev1, 4), low4));
+                __m128i byte1Low = _mm_shuffle_epi8(byte1LowTable, _mm_and_si128(prev1, low4));
+                __m128i byte2High = _mm_shuffle_epi8(byte2HighTable, _mm_and_si128(_mm_srli_epi16(input, 4), low4));
+                __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+                // 三字节、四字节序列的第三、四个字节必须是后续字节，此时 TwoConts 是预期的，异或抵消
+                __m128i prev2 = _mm_alignr_epi8(input, prevInput, 14);
+                __m128i prev3 = _mm_alignr_epi8(input, prevInput, 13);
+                __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80))),
+                                              _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80))));
+                return _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8(char(0x80))), special);
+            }
+
+            SJSON_UTF8_SSSE3 size_t ValidateSsse3(const unsigned char *s, size_t size) noexcept
+            {
+                const __m128i zero = _mm_setzero_si128();
+                // 块的最后三个字节若是需要后续字节的首字节，下一个块不能全是 ascii
+                const __m128i maxValue = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                       char(0xF0 - 1), char(0xE0 - 1), char(0xC0 - 1));
+                __m128i prev = zero, prevIncomplete = zero, error;
+                size_t i = 0;
+                for (; i + 16 <= size; i += 16)
+                {
+                    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+                    if (_mm_movemask_epi8(input) == 0)
+                        error = prevIncomplete;
+                    else
+                    {
+                        error = CheckBlock(input, prev);
+                        prevIncomplete = _mm_subs_epu8(input, maxValue);
+                    }
+                    prev = input;
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xFFFF)
+                        return ValidateScalar(s, LastBoundary(s, i), size);
+                }
+                // 剩余不足 16 字节时补 0 再检查一次，补上的 0 同时检查了结尾处不完整的序列
+                alignas(16) unsigned char tail[16] = {};
+                memcpy(tail, s + i, size - i);
+                error = CheckBlock(_mm_load_si128(reinterpret_cast<const __m128i *>(tail)), prev);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xFFFF)
+                    return ValidateScalar(s, LastBoundary(s, i), size);
+                return size;
+            }
+
+            bool HasSsse3() noexcept
+            {
+#ifdef __SSSE3__
+                return true;
+#else
+                static const bool supported = __builtin_cpu_supports("ssse3");
+                return supported;
+#endif
+            }
+#endif
+        }
+
+        size_t Decode(const char *p, size_t size, unsigned &u) noexcept
+        {
+            const unsigned char *s = reinterpret_cast<const unsigned char *>(p);
+            if (size == 0)
+                return 0;
+            unsigned char c = s[0];
+            if (c < 0x80)
+            {
+                u = c;
+                return 1;
+            }
+            // 首字节决定后续字节数，以及第二个字节的取值范围（排除过长编码、代理项、超过 U+10FFFF 的码点）
+            size_t n;
+            unsigned char lo = 0x80, hi = 0xBF;
+            if (c >= 0xC2 && c <= 0xDF)
+            {
+                n = 1;
+                u = c & 0x1F;
+            }
+            else if (c >= 0xE0 && c <= 0xEF)
+            {
+                n = 2;
+                u = c & 0x0F;
+                if (c == 0xE0)
+                    lo = 0xA0;
+                else if (c == 0xED)
+                    hi = 0x9F;
+            }
+            else if (c >= 0xF0 && c <= 0xF4)
+            {
+                n = 3;
+                u = c & 0x07;
+                if (c == 0xF0)
+                    lo = 0x90;
+                else if (c == 0xF4)
+                    hi = 0x8F;
+            }
+            else
+                return 0;
+            if (size <= n || s[1] < lo || s[1] > hi)
+                return 0;
+            for (size_t k = 1; k <= n; ++k)
+            {
+                if ((s[k] & 0xC0) != 0x80)
+                    return 0;
+                u = (u << 6) | (s[k] & 0x3F);
+            }
+            return n + 1;
+        }
+
+        size_t Validate(const char *data, size_t size) noexcept
+        {
+            const unsigned char *s = reinterpret_cast<const unsigned char *>(data);
+#ifdef SJSON_UTF8_SSSE3
+            if (HasSsse3())
+                return ValidateSsse3(s, size);
+#endif
+            return ValidateScalar(s, 0, size);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef JSONUTF8_H
+#define JSONUTF8_H
+#include <cstddef>
+
+namespace SJson
+{
+    /*
+     * utf-8 校验：x86 上支持 SSSE3 时用查表法（每次 16 字节，按前后字节的高低半字节查三张表得到错误位），
+     * 否则每次跳过 8 字节的 ascii，其余按 Unicode 标准表 3-7 的取值范围逐字节检查。
+     * 向量化部分只负责发现错误，出错时从所在块的字符边界起用逐字节检查给出精确位置。
+     */
+    namespace JsonUtf8
+    {
+        /* 校验 [data, data + size)，合法时返回 size，否则返回第一个非法序列首字节的偏移 */
+        size_t Validate(const char *data, size_t size) noexcept;
+        inline bool IsValid(const char *data, size_t size) noexcept
+        {
+            return Validate(data, size) == size;
+        }
+        /* 解码 p 处的一个字符，最多读取 size 个字节：返回序列长度并把码点写入 u，非法序列返回 0 */
+        size_t Decode(const char *p, size_t size, unsigned &u) noexcept;
+    }
+}
+#endif // JSONUTF8_H
@@ -1,17 +1,97 @@
 #include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <unordered_set>
 #include "JsonValue.h"
 #include "JsonParser.h"
 #include "JsonGenerator.h"
 namespace SJson
 {
+    namespace
+    {
+        template <typename T>
+        inline void Retain(JsonShared<T> *p) noexcept
+        {
+            p->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        template <typename T>
+        inline void Release(JsonShared<T> *p) noexcept
+        {
+            if (p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete p;
+        }
+
+        /* 负载被其他 JsonValue 共享时复制一份再修改，数组和对象只复制一层，子节点仍然共享；
+           独占时就地修改，清掉缓存的哈希。修改子节点必须先经过父节点的 Detach，因此沿途的缓存都会失效 */
+        template <typename T>
+        inline T &Detach(JsonShared<T> *&p) noexcept
+        {
+            if (p->refs.load(std::memory_order_acquire) != 1)
+            {
+                JsonShared<T> *copy = new JsonShared<T>(p->data);
+                Release(p);
+                p = copy;
+            }
+            else
+                p->hash.store(0, std::memory_order_relaxed);
+            return p->data;
+        }
+
+        inline size_t Mix(size_t h) noexcept
+        {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+
+        /* FNV-1a，结果与平台、运行次数无关 */
+        inline size_t HashBytes(const std::string &str) noexcept
+        {
+            size_t h = 0xcbf29ce484222325ULL;
+            for (unsigned char ch : str)
+                h = (h ^ ch) * 0x100000001b3ULL;
+            return h;
+        }
+
+        /* 短字符串存放在对象内部（SSO），不占用堆内存 */
+        inline size_t StringHeapBytes(const std::string &str) noexcept
+        {
+            static const size_t inlineCapacity = std::string().capacity();
+            return str.capacity() > inlineCapacity ? str.capacity() + 1 : 0;
+        }
+
+        /* 0 保留给“尚未计算” */
+        inline size_t NonZero(size_t h) noexcept
+        {
+            return h == 0 ? 1 : h;
+        }
+    }
+
     JsonValue &JsonValue::operator=(const JsonValue &rhs) noexcept
     {
+        if (this == &rhs)
+            return *this;
         Free();
         Init(rhs);
         return *this;
     }
 
+    JsonValue &JsonValue::operator=(JsonValue &&rhs) noexcept
+    {
+        if (this == &rhs)
+            return *this;
+        Free();
+        Steal(rhs);
+        return *this;
+    }
+
     JsonValue::~JsonValue() noexcept
     {
         Free();
@@ -37,134 +117,329 @@ namespace SJson
     double JsonValue::GetNumber() const noexcept
     {
         assert(m_type == JsonType::Number);
-        return m_num;
+        switch (m_numKind)
+        {
+        case JsonNumberKind::Int64:
+            return static_cast<double>(m_int);
+        case JsonNumberKind::Uint64:
+            return static_cast<double>(m_uint);
+        case TextInline:
+        {
+            // 原文可能正好占满 8 字节，没有结尾的 0
+            char buf[sizeof(m_text) + 1] = {};
+            memcpy(buf, m_text, sizeof(m_text));
+            return strtod(buf, nullptr);
+        }
+        case TextShared:
+        {
+            // 解析时已经校验过格式并排除了溢出，这里不会失败。转换结果的位模式缓存在负载的 hash 中（数字不使用它），
+            // 0 表示尚未转换；并发读取时各线程写入的是同一个值，原子读写保证没有数据竞争
+            if constexpr (sizeof(size_t) >= sizeof(double))
+            {
+                uint64_t bits = m_string->hash.load(std::memory_order_relaxed);
+                double d;
+                if (bits == 0)
+                {
+                    d = strtod(m_string->data.c_str(), nullptr);
+                    memcpy(&bits, &d, sizeof(bits));
+                    m_string->hash.store(size_t(bits), std::memory_order_relaxed);
+                }
+                else
+                    memcpy(&d, &bits, sizeof(d));
+                return d;
+            }
+            else
+                return strtod(m_string->data.c_str(), nullptr);
+        }
+        default:
+            return m_num;
+        }
     }
 
     void JsonValue::SetNumber(double d) noexcept
     {
         Free();
         m_type = JsonType::Number;
+        m_numKind = JsonNumberKind::Double;
         m_num = d;
     }
 
+    int JsonValue::GetNumberKind() const noexcept
+    {
+        assert(m_type == JsonType::Number);
+        return m_numKind >= TextInline ? JsonNumberKind::Double : m_numKind;
+    }
+
+    void JsonValue::SetNumberText(const char *text, size_t size) noexcept
+    {
+        Free();
+        m_type = JsonType::Number;
+        if (size <= sizeof(m_text))
+        {
+            m_numKind = TextInline;
+            memset(m_text, 0, sizeof(m_text));
+            memcpy(m_text, text, size);
+        }
+        else
+        {
+            m_numKind = TextShared;
+            m_string = new JsonShared<std::string>(std::string(text, size));
+        }
+    }
+
+    std::string_view JsonValue::GetNumberText() const noexcept
+    {
+        assert(m_type == JsonType::Number);
+        switch (m_numKind)
+        {
+        case TextInline:
+            return std::string_view(m_text, strnlen(m_text, sizeof(m_text)));
+        case TextShared:
+            return m_string->data;
+        default:
+            return std::string_view();
+        }
+    }
+
+    int64_t JsonValue::GetInt64() const noexcept
+    {
+        assert(m_type == JsonType::Number);
+        switch (m_numKind)
+        {
+        case JsonNumberKind::Int64:
+            return m_int;
+        case JsonNumberKind::Uint64:
+            return m_uint > uint64_t(INT64_MAX) ? INT64_MAX : int64_t(m_uint);
+        default:
+        {
+            // 超出范围时取边界值，NaN 取 0
+            double d = GetNumber();
+            if (!(d == d))
+                return 0;
+            if (d >= 9223372036854775808.0)
+                return INT64_MAX;
+            if (d < -9223372036854775808.0)
+                return INT64_MIN;
+            return static_cast<int64_t>(d);
+        }
+        }
+    }
+
+    uint64_t JsonValue::GetUint64() const noexcept
+    {
+        assert(m_type == JsonType::Number);
+        switch (m_numKind)
+        {
+        case JsonNumberKind::Int64:
+            return m_int < 0 ? 0 : uint64_t(m_int);
+        case JsonNumberKind::Uint64:
+            return m_uint;
+        default:
+        {
+            double d = GetNumber();
+            if (!(d > 0))
+                return 0;
+            if (d >= 18446744073709551616.0)
+                return UINT64_MAX;
+            return static_cast<uint64_t>(d);
+        }
+        }
+    }
+
+    void JsonValue::SetInt64(int64_t i) noexcept
+    {
+        Free();
+        m_type = JsonType::Number;
+        m_numKind = JsonNumberKind::Int64;
+        m_int = i;
+    }
+
+    void JsonValue::SetUint64(uint64_t u) noexcept
+    {
+        Free();
+        m_type = JsonType::Number;
+        m_numKind = JsonNumberKind::Uint64;
+        m_uint = u;
+    }
+
     const std::string &JsonValue::GetString() const noexcept
     {
         assert(m_type == JsonType::String);
-        return m_string;
+        return m_string->data;
     }
 
     void JsonValue::SetString(const std::string &str) noexcept
     {
-        if (m_type == JsonType::String)
-            m_string = str;
+        if (m_type == JsonType::String && m_string->refs.load(std::memory_order_acquire) == 1)
+            Detach(m_string) = str;
         else
         {
-            // 释放内存，然后重新设置字符串
+            // 释放内存（或者放弃共享），然后重新设置字符串
             Free();
             m_type = JsonType::String;
-            new (&m_string) std::string(str);
+            m_string = new JsonShared<std::string>(str);
+        }
+    }
+
+    void JsonValue::SetString(std::string &&str) noexcept
+    {
+        if (m_type == JsonType::String && m_string->refs.load(std::memory_order_acquire) == 1)
+            Detach(m_string) = std::move(str);
+        else
+        {
+            Free();
+            m_type = JsonType::String;
+            m_string = new JsonShared<std::string>(std::move(str));
         }
     }
 
     size_t JsonValue::GetArraySize() const noexcept
     {
         assert(m_type == JsonType::Array);
-        return m_array.size();
+        return m_array->data.size();
     }
 
     const JsonValue &JsonValue::GetArrayElement(size_t index) const noexcept
     {
         assert(m_type == JsonType::Array);
-        assert(index >= 0 && index < m_array.size());
-        return m_array[index];
+        assert(index >= 0 && index < m_array->data.size());
+        return m_array->data[index];
     }
 
     void JsonValue::SetArray(const std::vector<JsonValue> &arr) noexcept
     {
-        if (m_type == JsonType::Array)
-            m_array = arr;
+        if (m_type == JsonType::Array && m_array->refs.load(std::memory_order_acquire) == 1)
+            Detach(m_array) = arr;
         else
         {
             Free();
             m_type = JsonType::Array;
-            new (&m_array) std::vector<JsonValue>(arr);
+            m_array = new JsonShared<JsonArray>(arr);
         }
     }
 
     void JsonValue::PushbackArrayElement(const JsonValue &val) noexcept
     {
         assert(m_type == JsonType::Array);
-        m_array.push_back(val);
+        MutableArray().push_back(val);
     }
 
     void JsonValue::PopbackArrayElement() noexcept
     {
         assert(m_type == JsonType::Array);
-        m_array.pop_back();
+        MutableArray().pop_back();
     }
 
     void JsonValue::EraseArrayElement(size_t index, size_t count) noexcept
     {
         assert(m_type == JsonType::Array);
-        m_array.erase(m_array.begin() + index, m_array.begin() + index + count);
+        JsonArray &arr = MutableArray();
+        arr.erase(arr.begin() + index, arr.begin() + index + count);
     }
 
     void JsonValue::InsertArrayElement(const JsonValue &val, size_t index) noexcept
     {
         assert(m_type == JsonType::Array);
-        m_array.insert(m_array.begin() + index, val);
+        JsonArray &arr = MutableArray();
+        arr.insert(arr.begin() + index, val);
+    }
+
+    void JsonValue::PushbackArrayElement(JsonValue &&val) noexcept
+    {
+        assert(m_type == JsonType::Array);
+        MutableArray().push_back(std::move(val));
+    }
+
+    void JsonValue::InsertArrayElement(JsonValue &&val, size_t index) noexcept
+    {
+        assert(m_type == JsonType::Array);
+        JsonArray &arr = MutableArray();
+        arr.insert(arr.begin() + index, std::move(val));
+    }
+
+    bool JsonValue::SharesPayload(const JsonValue &rhs) const noexcept
+    {
+        if (m_type != rhs.m_type)
+            return false;
+        switch (m_type)
+        {
+        case JsonType::String:
+            return m_string == rhs.m_string;
+        case JsonType::Array:
+            return m_array == rhs.m_array;
+        case JsonType::Object:
+            return m_object == rhs.m_object;
+        default:
+            return false;
+        }
+    }
+
+    JsonValue &JsonValue::GetMutableArrayElement(size_t index) noexcept
+    {
+        assert(m_type == JsonType::Array);
+        assert(index < m_array->data.size());
+        return MutableArray()[index];
     }
 
     void JsonValue::ClearArray() noexcept
     {
         assert(m_type == JsonType::Array);
-        m_array.clear();
+        MutableArray().clear();
+    }
+
+    void JsonValue::Reserve(size_t capacity) noexcept
+    {
+        if (m_type == JsonType::Array)
+            MutableArray().reserve(capacity);
+        else if (m_type == JsonType::Object)
+            MutableObject().reserve(capacity);
     }
 
     void JsonValue::SetObject(const std::vector<std::pair<std::string, JsonValue>> &obj) noexcept
     {
-        if (m_type == JsonType::Object)
-            m_object = obj;
+        if (m_type == JsonType::Object && m_object->refs.load(std::memory_order_acquire) == 1)
+            Detach(m_object) = obj;
         else
         {
             Free();
             m_type = JsonType::Object;
-            new (&m_object) std::vector<std::pair<std::string, JsonValue>>(obj);
+            m_object = new JsonShared<JsonObject>(obj);
         }
     }
 
     size_t JsonValue::GetObjectSize() const noexcept
     {
         assert(m_type == JsonType::Object);
-        return m_object.size();
+        return m_object->data.size();
     }
 
     const std::string &JsonValue::GetObjectKey(size_t index) const noexcept
     {
         assert(m_type == JsonType::Object);
-        assert(index >= 0 && index < m_object.size());
-        return m_object[index].first;
+        assert(index >= 0 && index < m_object->data.size());
+        return m_object->data[index].first;
     }
 
     const JsonValue &JsonValue::GetObjectValue(size_t index) const noexcept
     {
         assert(m_type == JsonType::Object);
-        assert(index >= 0 && index < m_object.size());
-        return m_object[index].second;
+        assert(index >= 0 && index < m_object->data.size());
+        return m_object->data[index].second;
     }
 
     size_t JsonValue::GetObjectKeyLength(size_t index) const noexcept
     {
         assert(m_type == JsonType::Object);
-        return m_object[index].first.size();
+        return m_object->data[index].first.size();
     }
 
     long long JsonValue::FindObjectIndex(const std::string &key) const noexcept
     {
         assert(m_type == JsonType::Object);
-        for (size_t i = 0, n = m_object.size(); i < n; ++i)
+        const JsonObject &obj = m_object->data;
+        for (size_t i = 0, n = obj.size(); i < n; ++i)
         {
-            if (m_object[i].first == key)
+            if (obj[i].first == key)
                 return i;
         }
         return -1;
@@ -174,22 +449,55 @@ namespace SJson
     {
         assert(m_type == JsonType::Object);
         auto index = FindObjectIndex(key);
+        JsonObject &obj = MutableObject();
         if (index >= 0)
-            m_object[index].second = val;
+            obj[index].second = val;
         else
-            m_object.push_back(std::make_pair(key, val));
+            obj.push_back(std::make_pair(key, val));
+    }
+
+    void JsonValue::SetObjectValue(const std::string &key, JsonValue &&val) noexcept
+    {
+        assert(m_type == JsonType::Object);
+        auto index = FindObjectIndex(key);
+        JsonObject &obj = MutableObject();
+        if (index >= 0)
+            obj[index].second = std::move(val);
+        else
+            obj.emplace_back(key, std::move(val));
+    }
+
+    void JsonValue::InsertObjectValue(size_t index, const std::string &key, JsonValue &&val) noexcept
+    {
+        assert(m_type == JsonType::Object);
+        JsonObject &obj = MutableObject();
+        obj.emplace(obj.begin() + index, key, std::move(val));
+    }
+
+    void JsonValue::EmplaceObjectValue(std::string &&key, JsonValue &&val) noexcept
+    {
+        assert(m_type == JsonType::Object);
+        MutableObject().emplace_back(std::move(key), std::move(val));
+    }
+
+    JsonValue &JsonValue::GetMutableObjectValue(size_t index) noexcept
+    {
+        assert(m_type == JsonType::Object);
+        assert(index < m_object->data.size());
+        return MutableObject()[index].second;
     }
 
     void JsonValue::RemoveObjectValue(size_t index) noexcept
     {
         assert(m_type == JsonType::Object);
-        m_object.erase(m_object.begin() + index, m_object.begin() + index + 1);
+        JsonObject &obj = MutableObject();
+        obj.erase(obj.begin() + index, obj.begin() + index + 1);
     }
 
     void JsonValue::ClearObject() noexcept
     {
         assert(m_type == JsonType::Object);
-        m_object.clear();
+        MutableObject().clear();
     }
 
     void JsonValue::Stringify(std::string &content) const noexcept
@@ -199,68 +507,429 @@ namespace SJson
 
     void JsonValue::Init(const JsonValue &rhs) noexcept
     {
+        // 拷贝只增加负载的引用计数，耗时 O(1)
         m_type = rhs.m_type;
         m_num = 0;
         switch (m_type)
         {
         case JsonType::Number:
-            m_num = rhs.m_num;
+            // 按位拷贝，原文放在字符串负载中时增加引用计数
+            m_numKind = rhs.m_numKind;
+            m_uint = rhs.m_uint;
+            if (m_numKind == TextShared)
+                Retain(m_string);
             break;
         case JsonType::String:
-            new (&m_string) std::string(rhs.m_string);
+            m_string = rhs.m_string;
+            Retain(m_string);
             break;
         case JsonType::Array:
-            new (&m_array) std::vector<JsonValue>(rhs.m_array);
+            m_array = rhs.m_array;
+            Retain(m_array);
             break;
         case JsonType::Object:
-            new (&m_object) std::vector<std::pair<std::string, JsonValue>>(rhs.m_object);
+            m_object = rhs.m_object;
+            Retain(m_object);
+            break;
+        default:
+            // null、true、false 没有负载
             break;
         }
     }
-    void JsonValue::Free() noexcept
+    void JsonValue::Steal(JsonValue &rhs) noexcept
     {
-        using std::string;
+        m_type = rhs.m_type;
+        m_num = 0;
         switch (m_type)
         {
+        case JsonType::Number:
+            m_numKind = rhs.m_numKind;
+            m_uint = rhs.m_uint;
+            break;
         case JsonType::String:
-            m_string.~string(); // 显式调用相应的析构函数
+            m_string = rhs.m_string;
             break;
         case JsonType::Array:
-            m_array.~vector<JsonValue>();
+            m_array = rhs.m_array;
             break;
         case JsonType::Object:
-            m_object.~vector<std::pair<std::string, JsonValue>>();
+            m_object = rhs.m_object;
+            break;
+        default:
+            break;
         }
+        rhs.m_type = JsonType::Null;
     }
-    bool operator==(const JsonValue &lhs, const JsonValue &rhs) noexcept
+    void JsonValue::Free() noexcept
     {
-        if (lhs.m_type != rhs.m_type)
-            return false;
-        // 对于 true、false、null 这三种类型，比较类型后便完成比较。而对于数组、对象、数字、字符串，需要进一步检查是否相等
-        switch (lhs.m_type)
+        // 释放对负载的引用，最后一个引用者负责析构
+        switch (m_type)
         {
         case JsonType::Number:
-            return lhs.m_num == rhs.m_num;
+            if (m_numKind == TextShared)
+                Release(m_string);
+            break;
         case JsonType::String:
-            return lhs.m_string == rhs.m_string;
+            Release(m_string);
+            break;
         case JsonType::Array:
-            return lhs.m_array == rhs.m_array;
         case JsonType::Object:
-            // 对于对象，先比较键值对的个数是否相等
-            if (lhs.GetObjectSize() != rhs.GetObjectSize())
+            ReleaseTree();
+            break;
+        default:
+            break;
+        }
+        m_type = JsonType::Null;
+    }
+    void JsonValue::ReleaseTree() noexcept
+    {
+        // 深层嵌套的子容器先移到工作栈 pending 上再逐个释放，析构时不递归
+        std::vector<JsonValue> pending;
+        auto drop = [&pending](JsonValue &v) {
+            if (v.m_type == JsonType::Array)
+            {
+                JsonShared<JsonArray> *p = v.m_array;
+                v.m_type = JsonType::Null;
+                if (p->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    return;
+                for (auto &e : p->data)
+                    if (e.m_type == JsonType::Array || e.m_type == JsonType::Object)
+                        pending.push_back(std::move(e));
+                delete p;
+            }
+            else
+            {
+                JsonShared<JsonObject> *p = v.m_object;
+                v.m_type = JsonType::Null;
+                if (p->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    return;
+                for (auto &m : p->data)
+                    if (m.second.m_type == JsonType::Array || m.second.m_type == JsonType::Object)
+                        pending.push_back(std::move(m.second));
+                delete p;
+            }
+        };
+        drop(*this);
+        while (!pending.empty())
+        {
+            JsonValue v(std::move(pending.back()));
+            pending.pop_back();
+            drop(v);
+        }
+    }
+    std::string &JsonValue::MutableString() noexcept
+    {
+        assert(m_type == JsonType::String);
+        return Detach(m_string);
+    }
+    JsonArray &JsonValue::MutableArray() noexcept
+    {
+        assert(m_type == JsonType::Array);
+        return Detach(m_array);
+    }
+    JsonObject &JsonValue::MutableObject() noexcept
+    {
+        assert(m_type == JsonType::Object);
+        return Detach(m_object);
+    }
+    size_t JsonValue::CachedHash() const noexcept
+    {
+        switch (m_type)
+        {
+        case JsonType::Number:
+        {
+            // -0 与 0 相等，整数与相等的 double 也相等，因此统一按 double 计算哈希
+            double d = GetNumber();
+            if (d == 0)
+                d = 0.0;
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            return NonZero(Mix(bits + JsonType::Number));
+        }
+        case JsonType::String:
+        {
+            size_t h = m_string->hash.load(std::memory_order_relaxed);
+            if (h == 0)
+            {
+                h = NonZero(Mix(HashBytes(m_string->data) + JsonType::String));
+                m_string->hash.store(h, std::memory_order_relaxed);
+            }
+            return h;
+        }
+        case JsonType::Array:
+            return m_array->hash.load(std::memory_order_relaxed);
+        case JsonType::Object:
+            return m_object->hash.load(std::memory_order_relaxed);
+        default:
+            return NonZero(Mix(m_type));
+        }
+    }
+    size_t JsonValue::Hash() const noexcept
+    {
+        size_t h = CachedHash();
+        if (h != 0)
+            return h;
+        // 后序遍历，只进入尚未缓存哈希的容器；不递归，深层嵌套也不会栈溢出
+        struct Frame
+        {
+            const JsonValue *val;
+            size_t index;
+            size_t acc;
+        };
+        std::vector<Frame> stack;
+        stack.push_back({this, 0, size_t(m_type)});
+        while (!stack.empty())
+        {
+            Frame &f = stack.back();
+            const JsonValue &v = *f.val;
+            bool isArray = v.m_type == JsonType::Array;
+            size_t n = isArray ? v.m_array->data.size() : v.m_object->data.size();
+            if (f.index < n)
+            {
+                const JsonValue &child = isArray ? v.m_array->data[f.index] : v.m_object->data[f.index].second;
+                size_t ch = child.CachedHash();
+                if (ch == 0)
+                {
+                    stack.push_back({&child, 0, size_t(child.m_type)});
+                    continue;
+                }
+                // 数组按顺序合并；对象的成员用加法合并，与顺序无关
+                if (isArray)
+                    f.acc = Mix(f.acc * 31 + ch);
+                else
+                    f.acc += Mix(HashBytes(v.m_object->data[f.index].first) ^ (ch * 0x9e3779b97f4a7c15ULL));
+                ++f.index;
+                continue;
+            }
+            h = NonZero(Mix(f.acc + n));
+            if (isArray)
+                v.m_array->hash.store(h, std::memory_order_relaxed);
+            else
+                v.m_object->hash.store(h, std::memory_order_relaxed);
+            stack.pop_back();
+        }
+        return h;
+    }
+    void JsonValue::CollectStats(JsonStats &stats) const noexcept
+    {
+        // 被共享的负载只统计一次
+        std::unordered_set<const void *> seen;
+        auto firstVisit = [&seen](const auto *p)
+        { return p->refs.load(std::memory_order_relaxed) == 1 || seen.insert(p).second; };
+        auto addString = [&stats](const std::string &str)
+        {
+            stats.stringBytes += str.size();
+            if (size_t heap = StringHeapBytes(str))
+            {
+                ++stats.allocations;
+                stats.bytesAllocated += heap;
+                stats.slackBytes += str.capacity() - str.size();
+            }
+        };
+        std::vector<const JsonValue *> stack(1, this);
+        while (!stack.empty())
+        {
+            const JsonValue &v = *stack.back();
+            stack.pop_back();
+            ++stats.nodes[v.m_type];
+            switch (v.m_type)
+            {
+            case JsonType::Number:
+                // 延迟转换的数字只统计原文占用的堆内存，不计入 stringBytes
+                if (v.m_numKind != TextShared || !firstVisit(v.m_string))
+                    break;
+                ++stats.allocations;
+                stats.bytesAllocated += sizeof(*v.m_string);
+                if (size_t heap = StringHeapBytes(v.m_string->data))
+                {
+                    ++stats.allocations;
+                    stats.bytesAllocated += heap;
+                    stats.slackBytes += v.m_string->data.capacity() - v.m_string->data.size();
+                }
+                break;
+            case JsonType::String:
+                if (!firstVisit(v.m_string))
+                    break;
+                ++stats.allocations;
+                stats.bytesAllocated += sizeof(*v.m_string);
+                addString(v.m_string->data);
+                break;
+            case JsonType::Array:
+            {
+                if (!firstVisit(v.m_array))
+                    break;
+                const JsonArray &arr = v.m_array->data;
+                stats.allocations += arr.capacity() ? 2 : 1;
+                stats.bytesAllocated += sizeof(*v.m_array) + arr.capacity() * sizeof(JsonValue);
+                stats.slackBytes += (arr.capacity() - arr.size()) * sizeof(JsonValue);
+                for (const auto &e : arr)
+                    stack.push_back(&e);
+                break;
+            }
+            case JsonType::Object:
+            {
+                if (!firstVisit(v.m_object))
+                    break;
+                const JsonObject &obj = v.m_object->data;
+                stats.allocations += obj.capacity() ? 2 : 1;
+                stats.bytesAllocated += sizeof(*v.m_object) + obj.capacity() * sizeof(JsonObject::value_type);
+                stats.slackBytes += (obj.capacity() - obj.size()) * sizeof(JsonObject::value_type);
+                for (const auto &m : obj)
+                {
+                    addString(m.first);
+                    stack.push_back(&m.second);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+    void JsonValue::Compact() noexcept
+    {
+        // 深度优先依次重新分配：父节点的负载之后紧跟着它的子节点，容量与大小一致
+        std::vector<JsonValue *> stack(1, this);
+        while (!stack.empty())
+        {
+            JsonValue &v = *stack.back();
+            stack.pop_back();
+            switch (v.m_type)
+            {
+            case JsonType::String:
+                if (v.m_string->refs.load(std::memory_order_acquire) == 1)
+                {
+                    auto *block = new JsonShared<std::string>(std::string(v.m_string->data));
+                    block->hash.store(v.m_string->hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    Release(v.m_string);
+                    v.m_string = block;
+                }
+                break;
+            case JsonType::Array:
+                if (v.m_array->refs.load(std::memory_order_acquire) == 1)
+                {
+                    JsonArray &old = v.m_array->data;
+                    auto *block = new JsonShared<JsonArray>(JsonArray());
+                    block->hash.store(v.m_array->hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    block->data.reserve(old.size());
+                    for (auto &e : old)
+                        block->data.push_back(std::move(e));
+                    Release(v.m_array);
+                    v.m_array = block;
+                    for (size_t i = block->data.size(); i-- > 0;)
+                        stack.push_back(&block->data[i]);
+                }
+                break;
+            case JsonType::Object:
+                if (v.m_object->refs.load(std::memory_order_acquire) == 1)
+                {
+                    JsonObject &old = v.m_object->data;
+                    auto *block = new JsonShared<JsonObject>(JsonObject());
+                    block->hash.store(v.m_object->hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    block->data.reserve(old.size());
+                    for (auto &m : old)
+                        block->data.emplace_back(std::string(m.first), std::move(m.second));
+                    Release(v.m_object);
+                    v.m_object = block;
+                    for (size_t i = block->data.size(); i-- > 0;)
+                        stack.push_back(&block->data[i].second);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    bool operator==(const JsonValue &lhs, const JsonValue &rhs) noexcept
+    {
+        // 待比较的值对放在 pending 上，不递归，深层嵌套也不会栈溢出；标量的比较不会分配内存
+        std::vector<std::pair<const JsonValue *, const JsonValue *>> pending;
+        const JsonValue *a = &lhs, *b = &rhs;
+        for (;;)
+        {
+            if (a->m_type != b->m_type)
                 return false;
-            // 相等的话，对左边的键值对，依次在右边进行寻找
-            for (size_t i = 0, n = lhs.GetObjectSize(); i < n; i++)
+            // 对于 true、false、null 这三种类型，比较类型后便完成比较。而对于数组、对象、数字、字符串，需要进一步检查是否相等
+            switch (a->m_type)
+            {
+            case JsonType::Number:
+                // 两边都是整数时精确比较，否则按 double 比较
+                if (a->GetNumberKind() == JsonNumberKind::Double || b->GetNumberKind() == JsonNumberKind::Double)
+                {
+                    if (a->GetNumber() != b->GetNumber())
+                        return false;
+                }
+                else if (a->m_numKind == b->m_numKind)
+                {
+                    if (a->m_uint != b->m_uint)
+                        return false;
+                }
+                else if (!(a->GetInt64() >= 0 && b->GetInt64() >= 0 && a->GetUint64() == b->GetUint64()))
+                    return false;
+                break;
+            case JsonType::String:
+                if (!a->SharesPayload(*b) && a->m_string->data != b->m_string->data)
+                    return false;
+                break;
+            case JsonType::Array:
             {
-                // 根据左边对象的键值对，在右边对象中寻找相对应的索引
-                auto index = rhs.FindObjectIndex(lhs.GetObjectKey(i));
-                // key 不存在或者左右对象的 value 值不相等，直接返回 0
-                if (index < 0 || lhs.GetObjectValue(i) != rhs.GetObjectValue(index))
+                if (a->SharesPayload(*b))
+                    break;
+                const JsonArray &l = a->m_array->data, &r = b->m_array->data;
+                // 哈希不同必然不相等；哈希计算一次后缓存，子数组、子对象的比较不再重复计算
+                if (l.size() != r.size() || a->Hash() != b->Hash())
                     return false;
+                // 倒序压栈，按顺序比较
+                for (size_t i = l.size(); i-- > 0;)
+                    pending.emplace_back(&l[i], &r[i]);
+                break;
             }
-            return true;
-        default:
-            return true;
+            case JsonType::Object:
+            {
+                // 共享同一份负载的两个对象必然相等
+                if (a->SharesPayload(*b))
+                    break;
+                const JsonObject &l = a->m_object->data, &r = b->m_object->data;
+                // 先比较键值对的个数和哈希
+                if (l.size() != r.size() || a->Hash() != b->Hash())
+                    return false;
+                // key 顺序相同的前缀直接逐个配对
+                size_t i = 0, n = l.size();
+                for (; i < n && l[i].first == r[i].first; ++i)
+                    pending.emplace_back(&l[i].second, &r[i].second);
+                if (i == n)
+                    break;
+                // 剩余部分两边都按 key 稳定排序后逐个配对：成员顺序无关，同名的成员按出现顺序一一对应，
+                // 与 Hash 对所有成员求和的规则一致，相等的对象哈希必然相同；整体 O(n log n)
+                std::vector<const JsonObject::value_type *> sortedL, sortedR;
+                sortedL.reserve(n - i);
+                sortedR.reserve(n - i);
+                for (size_t k = i; k < n; ++k)
+                {
+                    sortedL.push_back(&l[k]);
+                    sortedR.push_back(&r[k]);
+                }
+                auto less = [](const JsonObject::value_type *x, const JsonObject::value_type *y)
+                { return x->first < y->first; };
+                std::stable_sort(sortedL.begin(), sortedL.end(), less);
+                std::stable_sort(sortedR.begin(), sortedR.end(), less);
+                for (size_t k = 0; k < sortedL.size(); ++k)
+                {
+                    // key 不同直接返回 false，value 留待比较
+                    if (sortedL[k]->first != sortedR[k]->first)
+                        return false;
+                    pending.emplace_back(&sortedL[k]->second, &sortedR[k]->second);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+            if (pending.empty())
+                return true;
+            a = pending.back().first;
+            b = pending.back().second;
+            pending.pop_back();
         }
     }
     bool operator!=(const JsonValue &lhs, const JsonValue &rhs) noexcept
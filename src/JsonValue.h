@@ -1,18 +1,39 @@
 #ifndef JSONVALUE_H
 #define JSONVALUE_H
 #include "Json.h"
+#include <atomic>
+#include <new>
 #include <vector>
 #include <utility>
 #include <string>
+#include <string_view>
 namespace SJson
 {
+    /* 字符串、数组、对象的负载带引用计数，拷贝 JsonValue 时只共享负载，修改时才复制（写时复制） */
+    template <typename T>
+    struct JsonShared
+    {
+        explicit JsonShared(const T &d) : data(d) {}
+        explicit JsonShared(T &&d) noexcept : data(std::move(d)) {}
+        std::atomic<long> refs{1};
+        /* 子树哈希的缓存，0 表示尚未计算；负载被修改时清零。延迟转换的数字借用它缓存转换后的 double */
+        mutable std::atomic<size_t> hash{0};
+        T data;
+    };
+
+    class JsonValue;
+    using JsonArray = std::vector<JsonValue>;
+    using JsonObject = std::vector<std::pair<std::string, JsonValue>>;
+
     class JsonValue
     {
     public:
         /* 构造函数 */
         JsonValue() noexcept { m_num = 0; }
         JsonValue(const JsonValue &rhs) noexcept { Init(rhs); }
+        JsonValue(JsonValue &&rhs) noexcept { Steal(rhs); }
         JsonValue &operator=(const JsonValue &rhs) noexcept;
+        JsonValue &operator=(JsonValue &&rhs) noexcept;
         ~JsonValue() noexcept;
 
         /* null true false */
@@ -23,10 +44,20 @@ namespace SJson
         /* number */
         double GetNumber() const noexcept;
         void SetNumber(double d) noexcept;
+        int GetNumberKind() const noexcept;
+        int64_t GetInt64() const noexcept;
+        uint64_t GetUint64() const noexcept;
+        void SetInt64(int64_t i) noexcept;
+        void SetUint64(uint64_t u) noexcept;
+        /* 延迟转换的数字：只保存已校验过的原文，读取时才转换；GetNumberKind 返回 Double */
+        void SetNumberText(const char *text, size_t size) noexcept;
+        /* 延迟转换的数字返回原文，其他数字返回空 */
+        std::string_view GetNumberText() const noexcept;
 
         /* string */
         const std::string &GetString() const noexcept;
         void SetString(const std::string &str) noexcept;
+        void SetString(std::string &&str) noexcept;
 
         /* array */
         size_t GetArraySize() const noexcept;
@@ -36,7 +67,11 @@ namespace SJson
         void PopbackArrayElement() noexcept;
         void EraseArrayElement(size_t index, size_t count) noexcept;
         void InsertArrayElement(const JsonValue &val, size_t index) noexcept;
+        void PushbackArrayElement(JsonValue &&val) noexcept;
+        void InsertArrayElement(JsonValue &&val, size_t index) noexcept;
         void ClearArray() noexcept;
+        /* 预留数组元素或对象成员的容量 */
+        void Reserve(size_t capacity) noexcept;
 
         /* object */
         void SetObject(const std::vector<std::pair<std::string, JsonValue>> &obj) noexcept;
@@ -46,29 +81,79 @@ namespace SJson
         size_t GetObjectKeyLength(size_t index) const noexcept;
         long long FindObjectIndex(const std::string &key) const noexcept;
         void SetObjectValue(const std::string &key, const JsonValue &val) noexcept;
+        void SetObjectValue(const std::string &key, JsonValue &&val) noexcept;
+        void InsertObjectValue(size_t index, const std::string &key, JsonValue &&val) noexcept;
+        /* 追加成员，不查找同名的 key，由调用者保证 key 不重复 */
+        void EmplaceObjectValue(std::string &&key, JsonValue &&val) noexcept;
         void RemoveObjectValue(size_t index) noexcept;
         void ClearObject() noexcept;
         /* serialize */
         void Stringify(std::string &content) const noexcept;
 
+        /* 子树哈希：对象与成员顺序无关，相等的值哈希相同；字符串、数组、对象的结果缓存在负载中 */
+        size_t Hash() const noexcept;
+
+        /* 累加整棵树的内存统计 */
+        void CollectStats(JsonStats &stats) const noexcept;
+        /* 去掉独占负载多余的容量，并按深度优先顺序重新分配，改善遍历时的局部性；被共享的负载保持不变 */
+        void Compact() noexcept;
+
+        /* 两个值是否共享同一份字符串、数组或对象负载（共享即相等） */
+        bool SharesPayload(const JsonValue &rhs) const noexcept;
+
+        /* 取得可修改的子节点：被共享的负载先复制一份，因此沿途只复制被修改的路径 */
+        JsonValue &GetMutableArrayElement(size_t index) noexcept;
+        JsonValue &GetMutableObjectValue(size_t index) noexcept;
+
     private:
         /* 初始化 JsonValue 与释放 JsonValue 的内存 */
 
         void Init(const JsonValue &rhs) noexcept;
+        /* 接管 rhs 的负载，rhs 变为 null */
+        void Steal(JsonValue &rhs) noexcept;
         void Free() noexcept;
+        /* 释放数组或对象负载，深层嵌套时不递归 */
+        void ReleaseTree() noexcept;
+        /* 取得可修改的负载：负载被共享时先复制一份，只复制当前这一层 */
+        std::string &MutableString() noexcept;
+        JsonArray &MutableArray() noexcept;
+        JsonObject &MutableObject() noexcept;
+        /* 标量直接计算哈希，容器返回缓存（未计算时为 0） */
+        size_t CachedHash() const noexcept;
+        /* 延迟转换的数字在 m_numKind 中使用的取值：不超过 8 字节的原文放在 m_text 中（不足补 0），更长的放在字符串负载中 */
+        enum : int
+        {
+            TextInline = 16,
+            TextShared
+        };
         JsonType::type m_type = JsonType::Null;
+        /* 数字的表示（JsonNumberKind 或上面的取值），放在 m_type 之后的填充位置，不增加 JsonValue 的大小 */
+        int m_numKind = JsonNumberKind::Double;
 
         union
         {
             double m_num;
-            std::string m_string;
-            std::vector<JsonValue> m_array;
-            std::vector<std::pair<std::string, JsonValue>> m_object;
+            int64_t m_int;
+            uint64_t m_uint;
+            char m_text[8];
+            JsonShared<std::string> *m_string;
+            JsonShared<JsonArray> *m_array;
+            JsonShared<JsonObject> *m_object;
         };
         friend bool operator==(const JsonValue &lhs, const JsonValue &rhs) noexcept;
+        friend class JsonParser;
     };
     /* 比较两个 json 值 */
     bool operator==(const JsonValue &lhs, const JsonValue &rhs) noexcept;
     bool operator!=(const JsonValue &lhs, const JsonValue &rhs) noexcept;
+
+    inline JsonValue &Json::Value() noexcept
+    {
+        return *std::launder(reinterpret_cast<JsonValue *>(&m_storage));
+    }
+    inline const JsonValue &Json::Value() const noexcept
+    {
+        return *std::launder(reinterpret_cast<const JsonValue *>(&m_storage));
+    }
 }
 #endif // JSONVALUE_H
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include <cassert>
+#include "JsonWriter.h"
+#include "JsonGenerator.h"
+namespace SJson
+{
+    JsonWriter::JsonWriter(std::string &out) noexcept : m_out(&out) {}
+
+    JsonWriter::JsonWriter(std::function<void(const char *data, size_t size)> sink, size_t bufferSize)
+        : m_out(&m_buffer), m_sink(std::move(sink)), m_bufferSize(bufferSize)
+    {
+        m_buffer.reserve(bufferSize);
+    }
+
+    JsonWriter::~JsonWriter() noexcept
+    {
+        try
+        {
+            Flush();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void JsonWriter::Flush()
+    {
+        if (m_sink && !m_buffer.empty())
+        {
+            m_sink(m_buffer.data(), m_buffer.size());
+            m_buffer.clear();
+        }
+    }
+
+    bool JsonWriter::IsComplete() const noexcept
+    {
+        return m_complete;
+    }
+
+    void JsonWriter::BeforeValue()
+    {
+        assert(!m_complete && "json writer: root already complete");
+        if (m_levels.empty())
+            return;
+        Level &level = m_levels.back();
+        if (level.isObject)
+        {
+            // 对象中的值紧跟在 key 之后，逗号已经在 Key 中输出
+            assert(m_keyPending && "json writer: object value without key");
+            m_keyPending = false;
+            return;
+        }
+        if (level.hasElements)
+            *m_out += ',';
+        level.hasElements = true;
+    }
+
+    void JsonWriter::AfterValue()
+    {
+        if (m_levels.empty())
+            m_complete = true;
+        if (m_sink && m_buffer.size() >= m_bufferSize)
+            Flush();
+    }
+
+    void JsonWriter::Start(char bracket, bool isObject)
+    {
+        BeforeValue();
+        *m_out += bracket;
+        m_levels.push_back(Level{isObject, false});
+    }
+
+    void JsonWriter::End(char bracket, bool isObject)
+    {
+        assert(!m_levels.empty() && m_levels.back().isObject == isObject && "json writer: mismatched end");
+        assert(!m_keyPending && "json writer: key without value");
+        (void)isObject;
+        m_levels.pop_back();
+        *m_out += bracket;
+        AfterValue();
+    }
+
+    void JsonWriter::StartObject()
+    {
+        Start('{', true);
+    }
+
+    void JsonWriter::EndObject()
+    {
+        End('}', true);
+    }
+
+    void JsonWriter::StartArray()
+    {
+        Start('[', false);
+    }
+
+    void JsonWriter::EndArray()
+    {
+        End(']', false);
+    }
+
+    void JsonWriter::Key(std::string_view key)
+    {
+        assert(!m_levels.empty() && m_levels.back().isObject && "json writer: key outside object");
+        assert(!m_keyPending && "json writer: key without value");
+        Level &level = m_levels.back();
+        if (level.hasElements)
+            *m_out += ',';
+        level.hasElements = true;
+        AppendString(key);
+        *m_out += ':';
+        m_keyPending = true;
+    }
+
+    void JsonWriter::Null()
+    {
+        BeforeValue();
+        *m_out += "null";
+        AfterValue();
+    }
+
+    void JsonWriter::Value(bool b)
+    {
+        BeforeValue();
+        *m_out += b ? "true" : "false";
+        AfterValue();
+    }
+
+    void JsonWriter::Value(double d)
+    {
+        BeforeValue();
+        JsonFormat::AppendNumber(*m_out, d);
+        AfterValue();
+    }
+
+    void JsonWriter::Value(std::string_view str)
+    {
+        BeforeValue();
+        AppendString(str);
+        AfterValue();
+    }
+
+    void JsonWriter::Value(const Json &json)
+    {
+        BeforeValue();
+        JsonGenerator generator;
+        generator.SetAsciiOutput(m_ascii);
+        generator.AppendValue(json, *m_out);
+        AfterValue();
+    }
+
+    void JsonWriter::SetAsciiOutput(bool ascii) noexcept
+    {
+        m_ascii = ascii;
+    }
+
+    void JsonWriter::AppendString(std::string_view str)
+    {
+        if (m_ascii)
+            JsonFormat::AppendAsciiString(*m_out, str);
+        else
+            JsonFormat::AppendString(*m_out, str);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "Json.h"
+#include "JsonFormat.h"
+
+namespace SJson
+{
+    /*
+     * 流式生成：不构造 Json，按调用顺序直接输出文本，逗号由 JsonWriter 自动补上。
+     * 转义与数字格式化和 JsonGenerator 共用 JsonFormat，输出与生成同一份 Json 的结果相同。
+     * 嵌套是否匹配（key 只能出现在对象中、End 与 Start 对应、根只有一个值）在 Debug 构建中用 assert 检查。
+     */
+    class JsonWriter
+    {
+    public:
+        /* 追加到 out */
+        explicit JsonWriter(std::string &out) noexcept;
+        /* 缓冲到 bufferSize 字节后写入 sink，析构或 Flush 时写出剩余部分 */
+        explicit JsonWriter(std::function<void(const char *data, size_t size)> sink, size_t bufferSize = 64 * 1024);
+        ~JsonWriter() noexcept;
+        JsonWriter(const JsonWriter &) = delete;
+        JsonWriter &operator=(const JsonWriter &) = delete;
+
+        void StartObject();
+        void EndObject();
+        void StartArray();
+        void EndArray();
+        void Key(std::string_view key);
+
+        void Null();
+        void Value(std::nullptr_t) { Null(); }
+        void Value(bool b);
+        void Value(double d);
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+        void Value(T v)
+        {
+            BeforeValue();
+            JsonFormat::AppendInteger(*m_out, v);
+            AfterValue();
+        }
+        void Value(std::string_view str);
+        void Value(const char *str) { Value(std::string_view(str)); }
+        void Value(const std::string &str) { Value(std::string_view(str)); }
+        /* 输出一棵已有的 Json 子树 */
+        void Value(const Json &json);
+
+        /* 只输出 7 位 ascii，与 JsonGenerator::SetAsciiOutput 相同 */
+        void SetAsciiOutput(bool ascii) noexcept;
+        /* 根值是否已经完整输出 */
+        bool IsComplete() const noexcept;
+        void Flush();
+
+    private:
+        /* 输出值之前补逗号，之后检查是否需要写出缓冲区 */
+        void BeforeValue();
+        void AfterValue();
+        void Start(char bracket, bool isObject);
+        void End(char bracket, bool isObject);
+        void AppendString(std::string_view str);
+
+        std::string *m_out;
+        std::string m_buffer;
+        std::function<void(const char *, size_t)> m_sink;
+        size_t m_bufferSize = 0;
+        /* 每一层：是否为对象、是否已有元素 */
+        struct Level
+        {
+            bool isObject;
+            bool hasElements;
+        };
+        std::vector<Level> m_levels;
+        /* 对象中已经输出了 key，等待 value */
+        bool m_keyPending = false;
+        bool m_complete = false;
+        bool m_ascii = false;
+    };
+}
+#endif // JSONWRITER_H
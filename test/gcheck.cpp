@@ -1,6 +1,27 @@
 #include <gtest/gtest.h>
 #include "../src/Json.h"
+#include "../src/JsonParser.h"
+#include "../src/JsonGenerator.h"
+#include "../src/JsonBatch.h"
+#include "../src/JsonParallelGenerator.h"
+#include "../src/JsonWriter.h"
+#include "../src/JsonReflect.h"
+#include "../src/JsonSnapshot.h"
+#include "../src/JsonUtf8.h"
+#include "../src/AtomicJsonSnapshot.h"
+#include "../src/JsonLinesWriter.h"
+#include <cstdio>
+#include <cstring>
+#include <atomic>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 static std::string status;
 
@@ -299,6 +320,8 @@ TEST(TestParseInvalidUnicodeSurrogate, ParseInvalidUnicodeSurrogate)
     test_error("parse invalid unicode surrogate", "\"\\uD800\\\\\"");
     test_error("parse invalid unicode surrogate", "\"\\uD800\\uDBFF\"");
     test_error("parse invalid unicode surrogate", "\"\\uD800\\uE000\"");
+    test_error("parse invalid unicode surrogate", "\"\\uDC00\"");
+    test_error("parse invalid unicode surrogate", "\"\\uDFFF\\uDC00\"");
 }
 
 // 测试解析缺失逗号或方括号
@@ -454,6 +477,31 @@ TEST(TestCopy, Copy)
     EXPECT_EQ(1, int(v2 == v1));
 }
 
+// 测试写时复制：拷贝共享节点，修改其中一份不影响另一份
+TEST(TestCopyOnWrite, CopyOnWrite)
+{
+    using namespace SJson;
+    SJson::Json v1, v2, e;
+    v1.Parse("{\"a\":[1,2,3],\"s\":\"abc\",\"o\":{\"x\":1}}");
+    v2 = v1;
+    e.SetNumber(4);
+    SJson::Json a = v2.GetObjectValue(0);
+    a.PushbackArrayElement(e);
+    v2.SetObjectValue("a", a);
+    e.SetString("def");
+    v2.SetObjectValue("s", e);
+
+    EXPECT_EQ(3, v1.GetObjectValue(0).GetArraySize());
+    EXPECT_EQ(4, v2.GetObjectValue(0).GetArraySize());
+    EXPECT_EQ("abc", v1.GetObjectValue(1).GetString());
+    EXPECT_EQ("def", v2.GetObjectValue(1).GetString());
+    EXPECT_EQ(1, int(v1.GetObjectValue(2) == v2.GetObjectValue(2)));
+
+    v2.RemoveObjectValue(2);
+    EXPECT_EQ(3, v1.GetObjectSize());
+    EXPECT_EQ(2, v2.GetObjectSize());
+}
+
 // 测试是否移动
 TEST(TestMove, Move)
 {
@@ -464,6 +512,63 @@ TEST(TestMove, Move)
     v3 = std::move(v2);
     EXPECT_EQ(JsonType::Null, v2.GetType());
     EXPECT_EQ(1, int(v3 == v1));
+    // 值直接存放在 Json 内部，被移走之后仍然可以继续使用
+    EXPECT_EQ(16, sizeof(Json));
+    SJson::Json v4(std::move(v3));
+    EXPECT_EQ(JsonType::Null, v3.GetType());
+    v3.SetNumber(2);
+    EXPECT_EQ(2, v3.GetNumber());
+    v4 = std::move(v4);
+    EXPECT_EQ(1, int(v4 == v1));
+}
+
+// 测试右值版本与就地构造
+TEST(TestMoveBuild, MoveBuild)
+{
+    using namespace SJson;
+    Json root, row, tags;
+    root.SetArray();
+    root.Reserve(2);
+    for (int i = 0; i < 2; ++i)
+    {
+        row.SetObject();
+        row.Reserve(5);
+        row.EmplaceObjectValue("id", i);
+        row.EmplaceObjectValue("name", std::string(32, char('a' + i)));
+        row.EmplaceObjectValue("ok", true);
+        row.EmplaceObjectValue("none", nullptr);
+        tags.SetArray();
+        tags.Reserve(3);
+        tags.EmplaceArrayElement("x");
+        tags.EmplaceArrayElement(0.5);
+        tags.EmplaceArrayElement(uint64_t(18446744073709551615ull));
+        row.EmplaceObjectValue("tags", std::move(tags));
+        EXPECT_EQ(JsonType::Null, tags.GetType());
+        root.PushbackArrayElement(std::move(row));
+        EXPECT_EQ(JsonType::Null, row.GetType());
+    }
+    std::string out;
+    root.Stringify(out);
+    EXPECT_EQ("[{\"id\":0,\"name\":\"" + std::string(32, 'a') + "\",\"ok\":true,\"none\":null,\"tags\":[\"x\",0.5,18446744073709551615]},"
+              "{\"id\":1,\"name\":\"" + std::string(32, 'b') + "\",\"ok\":true,\"none\":null,\"tags\":[\"x\",0.5,18446744073709551615]}]",
+              out);
+    // 预留的容量恰好用完，没有多余的空间
+    JsonStats stats;
+    root.GetStats(stats);
+    EXPECT_EQ(0, stats.slackBytes);
+
+    Json v, s;
+    v.SetObject();
+    s.SetString(std::string(40, 'z'));
+    v.SetObjectValue("k", std::move(s));
+    v.SetObjectValue("k", Json());
+    EXPECT_EQ(1, v.GetObjectSize());
+    EXPECT_EQ(JsonType::Null, v.GetObjectValue(0).GetType());
+    v.SetArray();
+    v.PushbackArrayElement(Json());
+    s = std::string("moved");
+    v.InsertArrayElement(std::move(s), 0);
+    EXPECT_EQ("moved", v.GetArrayElement(0).GetString());
 }
 
 // 测试是否交换
@@ -631,4 +736,1191 @@ TEST(TestAccessObject, AccessObject)
 
     o.ClearObject();
     EXPECT_EQ(0, o.GetObjectSize());
-}
\ No newline at end of file
+}
+// 测试可复用的解析器
+TEST(TestReusableParser, ReusableParser)
+{
+    using namespace SJson;
+    SJson::JsonParser parser;
+    SJson::Json v, copy;
+    parser.Parse(v, "{\"a\":[1,2,3],\"s\":\"abc\",\"o\":{\"k\":\"v\"}}", status);
+    EXPECT_EQ("parse ok", status);
+    copy = v;
+    // 解析到已有的 Json 中，被共享的旧负载不能被复用
+    parser.Parse(v, "{\"b\":[4,5],\"s\":\"xyz\"}", status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_EQ(3, copy.GetObjectSize());
+    EXPECT_EQ("abc", copy.GetObjectValue(1).GetString());
+    EXPECT_EQ(2, v.GetObjectSize());
+    EXPECT_EQ("xyz", v.GetObjectValue(1).GetString());
+
+    for (int i = 0; i < 3; ++i)
+    {
+        parser.Parse(v, "[{\"k\":\"v\"},[\"a\",\"b\"],\"c\"]", status);
+        EXPECT_EQ("parse ok", status);
+        EXPECT_EQ(3, v.GetArraySize());
+        EXPECT_EQ("b", v.GetArrayElement(1).GetArrayElement(1).GetString());
+        EXPECT_EQ("v", v.GetArrayElement(0).GetObjectValue(0).GetString());
+    }
+
+    parser.Parse(v, "[1,{\"a\":[2,", status);
+    EXPECT_EQ("parse expect value", status);
+    EXPECT_EQ(JsonType::Null, v.GetType());
+    parser.Parse(v, "[1,{\"a\":[2]}]", status);
+    EXPECT_EQ("parse ok", status);
+    copy.Parse("[1,{\"a\":[2]}]");
+    EXPECT_EQ(1, int(copy == v));
+}
+
+// 测试深层嵌套：解析与生成都不递归，超过最大深度时干净地失败
+TEST(TestDeepNesting, DeepNesting)
+{
+    using namespace SJson;
+    const size_t depth = 100000;
+    std::string content(depth, '[');
+    content.append(depth, ']');
+
+    SJson::JsonParser parser;
+    SJson::Json v;
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse ok", status);
+    std::string out;
+    v.Stringify(out);
+    EXPECT_EQ(content, out);
+
+    parser.SetMaxDepth(64);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse too deep", status);
+    EXPECT_EQ(JsonType::Null, v.GetType());
+    parser.Parse(v, "{\"a\":[{\"b\":[]}]}", status);
+    EXPECT_EQ("parse ok", status);
+    parser.SetMaxDepth(3);
+    parser.Parse(v, "{\"a\":[{\"b\":[]}]}", status);
+    EXPECT_EQ("parse too deep", status);
+
+    // 比较、diff、快照也不递归
+    std::string inner = std::string(depth, '[') + "1" + std::string(depth, ']');
+    std::string changed = std::string(depth, '[') + "2" + std::string(depth, ']');
+    Json a, b, p;
+    a.Parse(inner);
+    b.Parse(inner);
+    EXPECT_EQ(1, int(a == b));
+    b.Parse(changed);
+    EXPECT_EQ(0, int(a == b));
+    a.Diff(b, p);
+    EXPECT_EQ(1u, p.GetArraySize());
+    a.ApplyPatch(p);
+    EXPECT_EQ(1, int(a == b));
+
+    std::string buffer;
+    JsonSnapshot::Write(b, buffer);
+    JsonSnapshot snapshot;
+    snapshot.Load(buffer.data(), buffer.size(), status);
+    EXPECT_EQ("load ok", status);
+    Json back;
+    snapshot.GetRoot().ToJson(back);
+    EXPECT_EQ(1, int(back == b));
+}
+
+#define test_patch(doc, patch, expect)          \
+    do                                           \
+    {                                            \
+        SJson::Json d, p, e;                     \
+        d.Parse(doc);                            \
+        p.Parse(patch);                          \
+        e.Parse(expect);                         \
+        d.ApplyPatch(p, status);                 \
+        EXPECT_EQ("patch ok", status);           \
+        EXPECT_EQ(1, int(d == e));               \
+    } while (0)
+
+#define test_patch_error(error, doc, patch) \
+    do                                      \
+    {                                       \
+        SJson::Json d, p, e;                \
+        d.Parse(doc);                       \
+        e = d;                              \
+        p.Parse(patch);                     \
+        d.ApplyPatch(p, status);            \
+        EXPECT_EQ(error, status);           \
+        EXPECT_EQ(1, int(d == e));          \
+    } while (0)
+
+// 测试 JSON Patch
+TEST(TestPatch, Patch)
+{
+    test_patch("{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]", "{\"baz\":\"qux\",\"foo\":\"bar\"}");
+    test_patch("{\"foo\":[\"bar\",\"baz\"]}", "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]", "{\"foo\":[\"bar\",\"qux\",\"baz\"]}");
+    test_patch("{\"foo\":[\"bar\"]}", "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\"]}]", "{\"foo\":[\"bar\",[\"abc\"]]}");
+    test_patch("{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"remove\",\"path\":\"/baz\"}]", "{\"foo\":\"bar\"}");
+    test_patch("{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]", "{\"foo\":[\"bar\",\"baz\"]}");
+    test_patch("{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]", "{\"baz\":\"boo\",\"foo\":\"bar\"}");
+    test_patch("{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+               "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]",
+               "{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}");
+    test_patch("{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}", "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]",
+               "{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}");
+    test_patch("{\"a\":{\"b\":[1]}}", "[{\"op\":\"copy\",\"from\":\"/a/b\",\"path\":\"/c\"}]", "{\"a\":{\"b\":[1]},\"c\":[1]}");
+    test_patch("{\"a/b\":1,\"m~n\":2}", "[{\"op\":\"test\",\"path\":\"/a~1b\",\"value\":1},{\"op\":\"remove\",\"path\":\"/m~0n\"}]", "{\"a/b\":1}");
+    test_patch("{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"\",\"value\":[1]}]", "[1]");
+
+    test_patch_error("patch test failed", "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+                     "[{\"op\":\"add\",\"path\":\"/x\",\"value\":1},{\"op\":\"remove\",\"path\":\"/foo/0\"},"
+                     "{\"op\":\"replace\",\"path\":\"/baz\",\"value\":0},{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"}]");
+    test_patch_error("patch path not found", "{\"foo\":{\"bar\":1}}",
+                     "[{\"op\":\"move\",\"from\":\"/foo/bar\",\"path\":\"/baz\"},{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]");
+    test_patch_error("patch path not found", "{\"a\":[1,2]}", "[{\"op\":\"add\",\"path\":\"/a/3\",\"value\":3}]");
+    test_patch_error("patch path not found", "{\"a\":[1,2]}", "[{\"op\":\"remove\",\"path\":\"/a/01\"}]");
+    test_patch_error("patch invalid path", "{\"a\":{\"b\":1}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b\"}]");
+    test_patch_error("patch invalid path", "{\"a\":1}", "[{\"op\":\"remove\",\"path\":\"a\"}]");
+    test_patch_error("patch invalid operation", "{\"a\":1}", "[{\"op\":\"foo\",\"path\":\"/a\"}]");
+    test_patch_error("patch invalid", "{\"a\":1}", "{\"op\":\"remove\",\"path\":\"/a\"}");
+
+    // 修改只影响被 patch 的副本
+    SJson::Json v1, v2, p;
+    v1.Parse("{\"a\":{\"b\":[1,2]},\"c\":3}");
+    v2 = v1;
+    p.Parse("[{\"op\":\"add\",\"path\":\"/a/b/-\",\"value\":3}]");
+    v2.ApplyPatch(p);
+    EXPECT_EQ(2, v1.GetObjectValue(0).GetObjectValue(0).GetArraySize());
+    EXPECT_EQ(3, v2.GetObjectValue(0).GetObjectValue(0).GetArraySize());
+}
+
+// 测试 JSON Merge Patch
+TEST(TestMergePatch, MergePatch)
+{
+    SJson::Json d, p, e;
+    d.Parse("{\"title\":\"Goodbye!\",\"author\":{\"givenName\":\"John\",\"familyName\":\"Doe\"},\"tags\":[\"example\",\"sample\"],\"content\":\"This will be unchanged\"}");
+    p.Parse("{\"title\":\"Hello!\",\"phoneNumber\":\"+01-123-456-7890\",\"author\":{\"familyName\":null},\"tags\":[\"example\"]}");
+    e.Parse("{\"title\":\"Hello!\",\"author\":{\"givenName\":\"John\"},\"tags\":[\"example\"],\"content\":\"This will be unchanged\",\"phoneNumber\":\"+01-123-456-7890\"}");
+    d.ApplyMergePatch(p);
+    EXPECT_EQ(1, int(d == e));
+
+    d.Parse("{\"a\":\"b\"}");
+    p.Parse("{\"a\":{\"b\":{\"c\":null,\"d\":1}},\"e\":null}");
+    e.Parse("{\"a\":{\"b\":{\"d\":1}}}");
+    d.ApplyMergePatch(p);
+    EXPECT_EQ(1, int(d == e));
+
+    d.Parse("[1,2]");
+    p.Parse("[3]");
+    d.ApplyMergePatch(p);
+    EXPECT_EQ(1, int(d == p));
+
+    // patch 就是文档本身
+    d.Parse("{\"a\":null,\"b\":{\"c\":null,\"d\":1},\"e\":2,\"f\":null}");
+    e.Parse("{\"b\":{\"d\":1},\"e\":2}");
+    d.ApplyMergePatch(d);
+    EXPECT_EQ(1, int(d == e));
+    d.Parse("[{\"op\":\"add\",\"path\":\"/-\",\"value\":1}]");
+    e.Parse("[{\"op\":\"add\",\"path\":\"/-\",\"value\":1},1]");
+    d.ApplyPatch(d, status);
+    EXPECT_EQ("patch ok", status);
+    EXPECT_EQ(1, int(d == e));
+}
+
+// 测试结构化 diff：生成的 patch 应用到原文档后应得到目标文档
+#define test_diff(from, to)                          \
+    do                                               \
+    {                                                \
+        SJson::Json a, b, p;                         \
+        a.Parse(from);                               \
+        b.Parse(to);                                 \
+        a.Diff(b, p);                                \
+        EXPECT_EQ(SJson::JsonType::Array, p.GetType()); \
+        a.ApplyPatch(p);                             \
+        EXPECT_EQ(1, int(a == b));                   \
+    } while (0)
+
+TEST(TestDiff, Diff)
+{
+    // 输出就是输入之一
+    {
+        SJson::Json a, b, from, e;
+        a.Parse("[1,2,3]");
+        b.Parse("[1,3]");
+        from = a;
+        a.Diff(b, a);
+        e.Parse("[{\"op\":\"remove\",\"path\":\"/1\"}]");
+        EXPECT_EQ(1, int(a == e));
+        from.ApplyPatch(a);
+        EXPECT_EQ(1, int(from == b));
+        a.Parse("[1,2,3]");
+        a.Diff(b, b);
+        EXPECT_EQ(1, int(b == e));
+    }
+    test_diff("null", "null");
+    test_diff("1", "\"a\"");
+    test_diff("{\"a\":1,\"b\":[1,2,3]}", "{\"b\":[1,3],\"c\":{\"d\":true}}");
+    test_diff("{\"a/b\":1,\"m~n\":2}", "{\"a/b\":2}");
+    test_diff("[1,2,3,4,5]", "[0,1,3,5,6]");
+    test_diff("[{\"id\":1},{\"id\":2},{\"id\":3}]", "[{\"id\":2},{\"id\":3,\"x\":[]},{\"id\":4}]");
+    test_diff("[]", "[1,[2],{}]");
+    test_diff("[1,[2],{}]", "[]");
+    test_diff("[[1,2],[3,4]]", "[[1,2,5],[4]]");
+
+    // 写时复制的副本只修改了一处，diff 只生成一个操作
+    SJson::Json a, b, p, k;
+    a.Parse("{\"big\":[1,2,3,4,5,6,7,8],\"k\":1}");
+    b = a;
+    k.SetNumber(2);
+    b.SetObjectValue("k", k);
+    a.Diff(b, p);
+    EXPECT_EQ(1, p.GetArraySize());
+
+    // 相同的文档生成空 patch
+    a.Diff(a, p);
+    EXPECT_EQ(0, p.GetArraySize());
+
+    // 分别解析、不共享负载的相同子树按哈希跳过
+    a.Parse("{\"big\":[{\"x\":[1,2,3]},{\"y\":{\"z\":4}}],\"k\":1}");
+    b.Parse("{\"big\":[{\"x\":[1,2,3]},{\"y\":{\"z\":4}}],\"k\":2}");
+    a.Diff(b, p);
+    EXPECT_EQ(1, p.GetArraySize());
+
+    // 有重复 key 的对象整体替换，应用后与目标完全相同
+    test_diff("{\"a\":1,\"a\":2}", "{\"a\":3}");
+    test_diff("{\"a\":1}", "{\"a\":1,\"a\":2}");
+    test_diff("{\"o\":{\"k\":1,\"k\":2},\"x\":1}", "{\"o\":{\"k\":1,\"k\":3},\"x\":1}");
+    a.Parse("{\"o\":{\"k\":1,\"k\":2},\"x\":1}");
+    b.Parse("{\"o\":{\"k\":1,\"k\":3},\"x\":1}");
+    a.Diff(b, p);
+    ASSERT_EQ(1, p.GetArraySize());
+    EXPECT_EQ("/o", p.GetArrayElement(0).GetObjectValue(1).GetString());
+    a.ApplyPatch(p);
+    std::string out;
+    a.Stringify(out);
+    EXPECT_EQ("{\"o\":{\"k\":1,\"k\":3},\"x\":1}", out);
+}
+
+// 测试子树哈希与对象比较
+TEST(TestHash, Hash)
+{
+    SJson::Json a, b, v;
+    a.Parse("{\"x\":1,\"y\":[true,null,\"s\"],\"z\":{\"k\":-0}}");
+    b.Parse("{\"z\":{\"k\":0},\"y\":[true,null,\"s\"],\"x\":1}");
+    EXPECT_EQ(a.Hash(), b.Hash());
+    EXPECT_EQ(1, int(a == b));
+
+    // 修改子节点后缓存失效
+    v.SetNumber(2);
+    b.SetObjectValue("x", v);
+    EXPECT_NE(a.Hash(), b.Hash());
+    EXPECT_EQ(0, int(a == b));
+
+    // 写时复制的副本各自维护缓存
+    SJson::Json c = a;
+    EXPECT_EQ(a.Hash(), c.Hash());
+    c.SetObjectValue("w", v);
+    EXPECT_NE(a.Hash(), c.Hash());
+    EXPECT_EQ(0, int(a == c));
+
+    // 数组与顺序有关
+    a.Parse("[1,2]");
+    b.Parse("[2,1]");
+    EXPECT_NE(a.Hash(), b.Hash());
+
+    std::unordered_set<SJson::Json> set;
+    a.Parse("{\"a\":1,\"b\":2}");
+    b.Parse("{\"b\":2,\"a\":1}");
+    set.insert(a);
+    EXPECT_EQ(1, int(set.count(b)));
+
+    // 重复的 key：同名成员按出现顺序一一对应，相等时哈希相同
+    a.Parse("{\"a\":1,\"a\":2,\"b\":0}");
+    b.Parse("{\"b\":0,\"a\":1,\"a\":2}");
+    EXPECT_EQ(1, int(a == b));
+    EXPECT_EQ(a.Hash(), b.Hash());
+    b.Parse("{\"b\":0,\"a\":2,\"a\":1}");
+    EXPECT_EQ(0, int(a == b));
+    a.Parse("{\"a\":1,\"a\":1,\"b\":0}");
+    b.Parse("{\"b\":0,\"a\":1,\"a\":2}");
+    EXPECT_EQ(0, int(a == b));
+}
+
+// 测试内存统计与整理
+TEST(TestMemoryStats, MemoryStats)
+{
+    using namespace SJson;
+    Json v, e;
+    v.Parse("{\"name\":\"a string that is longer than the inline buffer\",\"list\":[1,2,3,null,true],\"o\":{}}");
+    JsonStats stats;
+    v.GetStats(stats);
+    EXPECT_EQ(1, stats.nodes[JsonType::Null]);
+    EXPECT_EQ(1, stats.nodes[JsonType::True]);
+    EXPECT_EQ(3, stats.nodes[JsonType::Number]);
+    EXPECT_EQ(1, stats.nodes[JsonType::String]);
+    EXPECT_EQ(1, stats.nodes[JsonType::Array]);
+    EXPECT_EQ(2, stats.nodes[JsonType::Object]);
+    EXPECT_EQ(46 + 4 + 4 + 1, stats.stringBytes);
+    EXPECT_LT(0, stats.allocations);
+    EXPECT_LT(stats.bytesAllocated, v.MemoryUsage());
+
+    // 追加元素会留下多余的容量，Compact 之后为 0，内容不变
+    e.SetArray();
+    for (int i = 0; i < 5; ++i)
+        e.PushbackArrayElement(v);
+    std::string before, after;
+    e.Stringify(before);
+    e.GetStats(stats);
+    EXPECT_LT(0, stats.slackBytes);
+    e.Compact();
+    e.GetStats(stats);
+    EXPECT_EQ(0, stats.slackBytes);
+    EXPECT_EQ(2, stats.nodes[JsonType::Array]);
+    e.Stringify(after);
+    EXPECT_EQ(before, after);
+
+    // 共享的负载只统计一次
+    Json a, b;
+    a.Parse("[[1,2,3],[4]]");
+    b.SetArray();
+    b.PushbackArrayElement(a);
+    b.PushbackArrayElement(a);
+    size_t single = a.MemoryUsage();
+    EXPECT_LT(b.MemoryUsage(), 2 * single);
+
+    JsonParser parser;
+    parser.SetStats(&stats);
+    parser.Parse(a, "[\"x\",[1]]");
+    EXPECT_EQ(2, stats.nodes[JsonType::Array]);
+    parser.Parse(a, "[\"y\",[2]]");
+    EXPECT_EQ(3, stats.reusedBlocks);
+}
+
+// 测试分阶段统计：只有定义了 SJSON_TRACE 才有数据
+TEST(TestTraceProfile, TraceProfile)
+{
+    using namespace SJson;
+    JsonParser parser;
+    Json v;
+    parser.Parse(v, " [\"abc\", 1.5, true, {\"k\": null}] ");
+    const JsonProfile &profile = parser.GetLastParseProfile();
+#ifdef SJSON_TRACE
+    EXPECT_EQ(true, profile.enabled);
+    EXPECT_EQ(2, profile.phases[JsonProfile::String].calls);
+    EXPECT_EQ(8, profile.phases[JsonProfile::String].bytes);
+    EXPECT_EQ(1, profile.phases[JsonProfile::Number].calls);
+    EXPECT_EQ(2, profile.phases[JsonProfile::Literal].calls);
+    EXPECT_EQ(2, profile.phases[JsonProfile::Container].calls);
+    EXPECT_EQ(1, profile.phases[JsonProfile::Total].calls);
+    EXPECT_EQ(33, profile.phases[JsonProfile::Total].bytes);
+#else
+    EXPECT_EQ(false, profile.enabled);
+    EXPECT_EQ(0, profile.phases[JsonProfile::Total].calls);
+#endif
+
+    JsonGenerator generator;
+    std::string res;
+    generator.Stringify(v, res);
+    const JsonProfile &out = generator.GetLastStringifyProfile();
+#ifdef SJSON_TRACE
+    EXPECT_EQ(res.size(), out.phases[JsonProfile::Total].bytes);
+    EXPECT_EQ(2, out.phases[JsonProfile::String].calls);
+#else
+    EXPECT_EQ(0, out.phases[JsonProfile::Total].bytes);
+#endif
+    EXPECT_FALSE(out.Summary().empty());
+}
+
+// 测试批量解析与生成
+TEST(TestBatch, Batch)
+{
+    using namespace SJson;
+    std::vector<std::string> inputs;
+    for (int i = 0; i < 100; ++i)
+        inputs.push_back("{\"id\":" + std::to_string(i) + ",\"tags\":[\"a\",\"b\"]}");
+    inputs[7] = "[1,2";
+    inputs[42] = "nul";
+    inputs[99] = "";
+
+    for (size_t threads : {1, 4})
+    {
+        JsonBatch batch(threads);
+        std::vector<Json> values(inputs.size());
+        std::vector<int> errors(inputs.size(), -1);
+        // 同一批输出解析两次，第二次复用第一次的负载
+        for (int round = 0; round < 2; ++round)
+        {
+            batch.ParseBatch(inputs.data(), values.data(), inputs.size(), errors.data());
+            EXPECT_EQ(JsonStatus::MissCommaOrSquareBracket, errors[7]);
+            EXPECT_EQ(JsonStatus::InvalidValue, errors[42]);
+            EXPECT_EQ(JsonStatus::ExpectValue, errors[99]);
+            EXPECT_EQ(JsonStatus::Ok, errors[0]);
+            EXPECT_EQ(JsonStatus::Ok, errors[98]);
+            EXPECT_EQ(JsonType::Null, values[7].GetType());
+            EXPECT_EQ(98.0, values[98].GetObjectValue(0).GetNumber());
+        }
+        std::vector<std::string> outputs(inputs.size());
+        batch.StringifyBatch(values.data(), outputs.data(), values.size());
+        EXPECT_EQ(inputs[3], outputs[3]);
+        EXPECT_EQ("null", outputs[42]);
+    }
+    EXPECT_STREQ("parse miss key", JsonStatus::Message(JsonStatus::MissKey));
+    EXPECT_EQ(JsonStatus::Unknown, JsonStatus::FromMessage("?"));
+}
+
+// 测试并行生成：输出与串行生成逐字节相同
+TEST(TestParallelStringify, ParallelStringify)
+{
+    using namespace SJson;
+    std::string content = "{\"meta\":{\"n\":1},\"rows\":[";
+    for (int i = 0; i < 1000; ++i)
+        content += (i ? ",{\"id\":" : "{\"id\":") + std::to_string(i) + ",\"s\":\"a\\tb\",\"v\":[1.5,null]}";
+    content += "],\"list\":[";
+    for (int i = 0; i < 300; ++i)
+        content += (i ? "," : "") + std::to_string(i);
+    content += "],\"tail\":true}";
+    Json v;
+    v.Parse(content);
+    std::string serial;
+    v.Stringify(serial);
+
+    for (size_t chunk : {1, 7, 64, 5000})
+    {
+        JsonParallelGenerator generator(4);
+        generator.SetChunkSize(chunk);
+        std::string parallel, streamed;
+        generator.Stringify(v, parallel);
+        EXPECT_EQ(serial, parallel);
+        generator.Stringify(v, [&](const char *data, size_t size)
+                            { streamed.append(data, size); });
+        EXPECT_EQ(serial, streamed);
+    }
+    // sink 抛出异常时，等待窗口的生成线程被取消，异常原样传出
+    {
+        JsonParallelGenerator generator(4);
+        generator.SetChunkSize(1);
+        size_t calls = 0;
+        EXPECT_THROW(generator.Stringify(v, [&](const char *, size_t)
+                                         {
+                                             if (++calls == 20)
+                                                 throw std::runtime_error("sink");
+                                         }),
+                     std::runtime_error);
+        EXPECT_EQ(20u, calls);
+        std::string streamed;
+        generator.Stringify(v, [&](const char *data, size_t size)
+                            { streamed.append(data, size); });
+        EXPECT_EQ(serial, streamed);
+    }
+
+    Json a;
+    a.Parse("[[],{},[[1]],\"x\"]");
+    a.Stringify(serial);
+    JsonParallelGenerator generator(3);
+    generator.SetChunkSize(1);
+    std::string parallel;
+    generator.Stringify(a, parallel);
+    EXPECT_EQ(serial, parallel);
+}
+
+// 测试流式生成
+TEST(TestJsonWriter, JsonWriter)
+{
+    using namespace SJson;
+    std::string out;
+    {
+        JsonWriter w(out);
+        w.StartObject();
+        w.Key("n");
+        w.Null();
+        w.Key("b");
+        w.Value(true);
+        w.Key("d");
+        w.Value(1.5);
+        w.Key("i");
+        w.Value(-42);
+        w.Key("s");
+        w.Value("a\"b\n");
+        w.Key("a");
+        w.StartArray();
+        w.Value(1u);
+        w.StartArray();
+        w.EndArray();
+        w.StartObject();
+        w.EndObject();
+        w.EndArray();
+        EXPECT_FALSE(w.IsComplete());
+        w.EndObject();
+        EXPECT_TRUE(w.IsComplete());
+    }
+    EXPECT_EQ("{\"n\":null,\"b\":true,\"d\":1.5,\"i\":-42,\"s\":\"a\\\"b\\n\",\"a\":[1,[],{}]}", out);
+
+    // 与生成同一份 Json 的结果相同
+    Json v;
+    std::string expect;
+    v.Parse(out);
+    v.Stringify(expect);
+    std::string streamed;
+    {
+        JsonWriter w([&](const char *data, size_t size)
+                     { streamed.append(data, size); },
+                     8);
+        w.StartArray();
+        for (int i = 0; i < 3; ++i)
+            w.Value(v);
+        w.EndArray();
+    }
+    EXPECT_EQ("[" + expect + "," + expect + "," + expect + "]", streamed);
+}
+
+// 测试字段投影：只建立选中的字段
+#define test_projection(expect, content, ...)               \
+    do                                                      \
+    {                                                       \
+        SJson::JsonParser parser;                           \
+        SJson::Json v, e;                                   \
+        std::string status;                                 \
+        parser.Parse(v, content, SJson::JsonProjection{__VA_ARGS__}, status); \
+        EXPECT_EQ("parse ok", status);                      \
+        e.Parse(expect);                                    \
+        EXPECT_EQ(1, int(v == e));                          \
+    } while (0)
+
+TEST(TestProjection, Projection)
+{
+    test_projection("{\"id\":1,\"name\":\"a\"}", "{\"id\":1,\"x\":[1,{\"y\":\"]\"}],\"name\":\"a\",\"z\":{}}", "/id", "/name");
+    test_projection("{\"user\":{\"name\":\"n\"}}", "{\"user\":{\"age\":3,\"name\":\"n\",\"tags\":[]},\"other\":null}", "/user/name");
+    test_projection("{\"user\":{\"age\":3,\"name\":\"n\"}}", "{\"user\":{\"age\":3,\"name\":\"n\"}}", "/user/name", "/user");
+    // 数组的每一个元素都应用投影
+    test_projection("[{\"id\":1},{\"id\":2},{},3]", "[{\"id\":1,\"a\":true},{\"b\":[],\"id\":2},{\"c\":1},3]", "/id");
+    test_projection("{\"rows\":[{\"v\":1},{\"v\":2}]}", "{\"n\":2,\"rows\":[{\"v\":1,\"w\":0},{\"v\":2}]}", "/rows/v");
+    test_projection("{}", "{\"a\":1,\"b\":2}", "/c");
+    test_projection("{\"a/b\":1}", "{\"a/b\":1,\"a~b\":2}", "/a~1b");
+    test_projection("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2}", "");
+
+    // 跳过的部分仍然校验
+    SJson::JsonParser parser;
+    SJson::Json v;
+    std::string status;
+    SJson::JsonProjection projection{"/id"};
+    parser.Parse(v, "{\"id\":1,\"x\":[1,}", projection, status);
+    EXPECT_EQ("parse invalid value", status);
+    parser.Parse(v, "{\"x\":\"\\q\",\"id\":1}", projection, status);
+    EXPECT_EQ("parse invalid string escape", status);
+    parser.Parse(v, "{\"x\":{\"a\" 1}}", projection, status);
+    EXPECT_EQ("parse miss colon", status);
+    parser.Parse(v, "{\"x\":1 \"id\":1}", projection, status);
+    EXPECT_EQ("parse miss comma or curly bracket", status);
+    // 解析器复用：投影之后仍能完整解析
+    parser.Parse(v, "{\"id\":1,\"x\":[1]}", status);
+    EXPECT_EQ(2, v.GetObjectSize());
+}
+
+// 测试 64 位整数：超过 2^53 的整数按原样往返
+TEST(TestInt64, Int64)
+{
+    using namespace SJson;
+    test_roundtrip("9007199254740993");
+    test_roundtrip("-9223372036854775808");
+    test_roundtrip("18446744073709551615");
+    test_roundtrip("[0,-1,4294967296,1.5]");
+
+    Json j;
+    j.Parse("9223372036854775807", status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_EQ(JsonNumberKind::Int64, j.GetNumberKind());
+    EXPECT_EQ(INT64_MAX, j.GetInt64());
+    j.Parse("9223372036854775808", status);
+    EXPECT_EQ(JsonNumberKind::Uint64, j.GetNumberKind());
+    EXPECT_EQ(9223372036854775808ULL, j.GetUint64());
+    EXPECT_EQ(INT64_MAX, j.GetInt64());
+    // 超出 uint64 范围、负零、带小数或指数的数字仍然是 double
+    j.Parse("18446744073709551616", status);
+    EXPECT_EQ(JsonNumberKind::Double, j.GetNumberKind());
+    j.Parse("-0", status);
+    EXPECT_EQ(JsonNumberKind::Double, j.GetNumberKind());
+    j.Parse("1e2", status);
+    EXPECT_EQ(JsonNumberKind::Double, j.GetNumberKind());
+    EXPECT_EQ(100, j.GetInt64());
+
+    // 整数与 double 按数值比较，两个整数精确比较
+    Json a, b;
+    a.SetInt64(1);
+    b.SetNumber(1.0);
+    EXPECT_TRUE(a == b);
+    EXPECT_EQ(a.Hash(), b.Hash());
+    a.SetInt64(9007199254740993);
+    b.SetInt64(9007199254740992);
+    EXPECT_FALSE(a == b);
+    a.SetUint64(UINT64_MAX);
+    EXPECT_EQ(UINT64_MAX, a.GetUint64());
+    EXPECT_EQ(0, a.GetInt64() == -1);
+
+    // 快照保留整数表示
+    j.Parse("[9007199254740993,18446744073709551615,-5,0.5]", status);
+    std::string buffer;
+    JsonSnapshot::Write(j, buffer);
+    JsonSnapshot snapshot;
+    snapshot.Load(buffer.data(), buffer.size(), status);
+    EXPECT_EQ("load ok", status);
+    JsonSnapshotView root = snapshot.GetRoot();
+    EXPECT_EQ(9007199254740993, root.GetArrayElement(0).GetInt64());
+    EXPECT_EQ(JsonNumberKind::Uint64, root.GetArrayElement(1).GetNumberKind());
+    EXPECT_EQ(-5, root.GetArrayElement(2).GetInt64());
+    EXPECT_EQ(0.5, root.GetArrayElement(3).GetNumber());
+    Json back;
+    root.ToJson(back);
+    EXPECT_TRUE(back == j);
+    EXPECT_EQ(JsonNumberKind::Int64, back.GetArrayElement(0).GetNumberKind());
+}
+
+// 测试 utf-8 校验：非法序列返回首字节的偏移
+#define test_utf8(expect, content) EXPECT_EQ(size_t(expect), SJson::JsonUtf8::Validate(content, sizeof(content) - 1))
+
+TEST(TestUtf8, Utf8)
+{
+    test_utf8(0, "");
+    test_utf8(22, "ascii \xC3\xA9 \xE4\xB8\xAD \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF");
+    test_utf8(0, "\x80");             // 单独的后续字节
+    test_utf8(1, "a\xC0\xAF");        // 过长编码
+    test_utf8(0, "\xE0\x9F\xBF");     // 过长编码
+    test_utf8(0, "\xED\xA0\x80");     // 代理项
+    test_utf8(0, "\xF4\x90\x80\x80"); // 超过 U+10FFFF
+    test_utf8(0, "\xF8\x88\x80\x80\x80");
+    test_utf8(2, "ab\xE4\xB8");       // 结尾不完整
+    test_utf8(1, "a\xC3" "b");
+    // 跨越 16 字节块边界的序列
+    test_utf8(35, "0123456789abcdef012345678901234\xF0\x9F\x98\x80\xE4\xB8" "0123456789abcdef");
+    test_utf8(35, "0123456789abcdef0123456789abcdef\xE4\xB8\xAD\xFF" "0123456789abcdef");
+    test_utf8(16, "0123456789abcdef\x80" "0123456789abcdef");
+    test_utf8(15, "0123456789abcde\xE4\xB8");
+
+    SJson::JsonParser parser;
+    SJson::Json v;
+    std::string status, content = "[\"ab\xFF\"]";
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse ok", status);
+    parser.SetValidateUtf8(true);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse invalid utf8", status);
+    EXPECT_EQ(4, parser.GetErrorOffset());
+    EXPECT_EQ(SJson::JsonStatus::InvalidUtf8, SJson::JsonStatus::FromMessage(status.c_str()));
+    parser.Parse(v, "[\"\xE4\xB8\xAD\"]", status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_EQ("\xE4\xB8\xAD", v.GetArrayElement(0).GetString());
+    parser.Parse(v, "[1,]", status);
+    EXPECT_EQ("parse invalid value", status);
+    EXPECT_EQ(3, parser.GetErrorOffset());
+}
+
+// 测试只输出 ascii：非 ascii 字符写成 \u 转义，解析回来与原文相同
+TEST(TestAsciiOutput, AsciiOutput)
+{
+    SJson::Json v, back;
+    v.Parse("{\"\xE9\x94\xAE\":[\"a\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x98\x80\\\"\\n\",\"0123456789abcdef0123456789\xC3\xA9\"]}");
+    SJson::JsonGenerator generator;
+    std::string out;
+    generator.SetAsciiOutput(true);
+    generator.Stringify(v, out);
+    EXPECT_EQ("{\"\\u952E\":[\"a\\u00E9\\u4E2D\\uD83D\\uDE00\\\"\\n\",\"0123456789abcdef0123456789\\u00E9\"]}", out);
+    back.Parse(out, status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_TRUE(back == v);
+
+    // 非法的 utf-8 字节替换为 U+FFFD
+    v.SetString("a\xFF\xC3");
+    generator.Stringify(v, out);
+    EXPECT_EQ("\"a\\uFFFD\\uFFFD\"", out);
+
+    // 关闭后原样输出
+    generator.SetAsciiOutput(false);
+    v.SetString("\xC3\xA9");
+    generator.Stringify(v, out);
+    EXPECT_EQ("\"\xC3\xA9\"", out);
+
+    std::string written;
+    {
+        SJson::JsonWriter writer(written);
+        writer.SetAsciiOutput(true);
+        writer.StartObject();
+        writer.Key("\xC3\xA9");
+        writer.Value(v);
+        writer.EndObject();
+    }
+    EXPECT_EQ("{\"\\u00E9\":\"\\u00E9\"}", written);
+}
+
+// 测试可原子替换的文档：读者总是看到完整的某一版，旧版在读者离开后回收
+TEST(TestAtomicJsonSnapshot, AtomicJsonSnapshot)
+{
+    using namespace SJson;
+    AtomicJsonSnapshot config;
+    EXPECT_EQ(JsonType::Null, config.Read()->GetType());
+
+    std::string status;
+    config.Publish("{\"version\":0,\"name\":\"v0\"}", status);
+    EXPECT_EQ("parse ok", status);
+    config.Publish("{\"version\":", status);
+    EXPECT_NE("parse ok", status);
+    EXPECT_EQ(0, config.Read()->GetObjectValue(0).GetNumber());
+
+    {
+        // 持有读者期间旧版不会被回收，嵌套的读也可以
+        auto held = config.Read();
+        auto nested = config.Read();
+        Json next;
+        next.Parse("{\"version\":1,\"name\":\"v1\"}");
+        config.Publish(std::move(next));
+        EXPECT_EQ(1, config.Reclaim());
+        EXPECT_EQ("v0", held->GetObjectValue(1).GetString());
+        EXPECT_EQ("v1", config.Read()->GetObjectValue(1).GetString());
+    }
+    EXPECT_EQ(0, config.Reclaim());
+
+    std::atomic<bool> stop{false};
+    std::atomic<long> mismatches{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&]
+                             {
+                                 double last = 0;
+                                 while (!stop.load(std::memory_order_relaxed))
+                                 {
+                                     auto doc = config.Read();
+                                     double version = doc->GetObjectValue(0).GetNumber();
+                                     if (doc->GetObjectValue(1).GetString() != "v" + std::to_string(int(version)) || version < last)
+                                         ++mismatches;
+                                     last = version;
+                                 } });
+    }
+    for (int v = 2; v < 300; ++v)
+    {
+        Json doc;
+        doc.SetObject();
+        doc.EmplaceObjectValue("version", v);
+        doc.EmplaceObjectValue("name", "v" + std::to_string(v));
+        config.Publish(std::move(doc));
+    }
+    stop = true;
+    for (auto &t : readers)
+        t.join();
+    EXPECT_EQ(0, mismatches.load());
+    EXPECT_EQ(0, config.Reclaim());
+    EXPECT_EQ(299, config.Read()->GetObjectValue(0).GetNumber());
+}
+
+// 测试异步写出 JSON Lines：多个线程同时写入，每个线程的行保持顺序，小缓冲区与背压下不丢行
+TEST(TestJsonLinesWriter, JsonLinesWriter)
+{
+    using namespace SJson;
+    FILE *file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    {
+        JsonLinesWriter::Options options;
+        options.bufferSize = 256;
+        options.maxPendingBuffers = 2;
+        options.flushIntervalMs = 1;
+        JsonLinesWriter writer(fileno(file), options);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&writer, t]
+                                 {
+                                     Json line;
+                                     line.SetObject();
+                                     line.EmplaceObjectValue("t", t);
+                                     line.EmplaceObjectValue("i", 0);
+                                     line.EmplaceObjectValue("msg", "a\"b");
+                                     for (int i = 0; i < 2000; ++i)
+                                     {
+                                         Json n;
+                                         n.SetInt64(i);
+                                         line.SetObjectValue("i", std::move(n));
+                                         if (i % 2)
+                                             writer.Append(line);
+                                         else
+                                         {
+                                             std::string s;
+                                             line.Stringify(s);
+                                             writer.Append(s);
+                                         }
+                                     } });
+        }
+        for (auto &t : threads)
+            t.join();
+        writer.Flush();
+        EXPECT_EQ(0, writer.GetWriteError());
+        EXPECT_EQ(0, writer.GetDroppedLines());
+        writer.Append("{\"last\":true}");
+    }
+    rewind(file);
+    std::string content;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        content.append(buffer, n);
+    fclose(file);
+
+    int next[4] = {0, 0, 0, 0};
+    size_t lines = 0, pos = 0, end;
+    Json v;
+    while ((end = content.find('\n', pos)) != std::string::npos)
+    {
+        v.Parse(content.substr(pos, end - pos), status);
+        ASSERT_EQ("parse ok", status);
+        if (v.GetObjectSize() == 3)
+        {
+            int t = int(v.GetObjectValue(0).GetInt64());
+            EXPECT_EQ(next[t]++, v.GetObjectValue(1).GetInt64());
+        }
+        ++lines;
+        pos = end + 1;
+    }
+    EXPECT_EQ(content.size(), pos);
+    EXPECT_EQ(8001, lines);
+
+    // 写失败时记录 errno，之后的行被丢弃
+    JsonLinesWriter bad(-1);
+    bad.Append("1");
+    bad.Flush();
+    EXPECT_EQ(EBADF, bad.GetWriteError());
+
+#ifndef _WIN32
+    // dropWhenFull 只丢弃追加时溢出的行：队列已满时 Flush 等待写出，不丢弃调用之前追加的行。
+    // 管道先不读，后台线程写满管道后阻塞，队列保持已满
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    std::string received;
+    std::thread reader([&received, fd = fds[0]]
+                       {
+                           std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                           char chunk[4096];
+                           ssize_t got;
+                           while ((got = read(fd, chunk, sizeof(chunk))) > 0)
+                               received.append(chunk, got);
+                       });
+    uint64_t dropped;
+    {
+        JsonLinesWriter::Options options;
+        options.bufferSize = 1024;
+        options.maxPendingBuffers = 1;
+        options.dropWhenFull = true;
+        options.flushIntervalMs = 0;
+        JsonLinesWriter writer(fds[1], options);
+        std::string line(1100, 'x');
+        for (int i = 0; i < 200; ++i)
+            writer.Append("\"" + line + "\"");
+        writer.Append("\"tail\"");
+        writer.Flush();
+        dropped = writer.GetDroppedLines();
+        EXPECT_GT(dropped, 0u);
+    }
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    EXPECT_EQ(201 - dropped, size_t(std::count(received.begin(), received.end(), '\n')));
+    EXPECT_EQ("\"tail\"\n", received.substr(received.size() - 7));
+#endif
+}
+
+// 测试延迟转换的数字
+TEST(TestLazyNumbers, LazyNumbers)
+{
+    SJson::JsonParser parser;
+    SJson::JsonGenerator generator;
+    SJson::Json v, eager;
+    std::string out;
+    const std::string content = "[1.10,2.50E+3,-0,0.1234567890123456789,123456789012345678901234,7,-8]";
+    parser.SetLazyNumbers(true);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse ok", status);
+    // 原文原样输出，长短原文都一样
+    generator.Stringify(v, out);
+    EXPECT_EQ(content, out);
+    // 读取时转换，种类与相等比较和非延迟解析一致
+    eager.Parse(content);
+    EXPECT_TRUE(v == eager);
+    EXPECT_EQ(v.Hash(), eager.Hash());
+    EXPECT_DOUBLE_EQ(1.1, v.GetArrayElement(0).GetNumber());
+    EXPECT_EQ(2500, v.GetArrayElement(1).GetInt64());
+    EXPECT_EQ(SJson::JsonNumberKind::Double, v.GetArrayElement(3).GetNumberKind());
+    EXPECT_EQ(SJson::JsonNumberKind::Int64, v.GetArrayElement(5).GetNumberKind());
+    // 长原文第一次读取后缓存转换结果，多线程同时读取得到同一个值，哈希不受缓存影响
+    {
+        const double expected = strtod("0.1234567890123456789", nullptr);
+        std::vector<std::thread> readers;
+        std::atomic<int> mismatches{0};
+        for (int t = 0; t < 4; ++t)
+            readers.emplace_back([&]
+                                 {
+                                     for (int i = 0; i < 1000; ++i)
+                                         if (v.GetArrayElement(3).GetNumber() != expected)
+                                             ++mismatches; });
+        for (auto &t : readers)
+            t.join();
+        EXPECT_EQ(0, mismatches.load());
+        EXPECT_EQ(expected, v.GetArrayElement(3).GetNumber());
+        EXPECT_EQ(v.Hash(), eager.Hash());
+        EXPECT_TRUE(v == eager);
+    }
+
+    // 拷贝共享原文，修改后按新值输出
+    SJson::Json copy = v, half;
+    half.SetNumber(0.5);
+    copy.EraseArrayElement(0, 1);
+    copy.InsertArrayElement(half, 0);
+    generator.Stringify(copy, out);
+    EXPECT_EQ("[0.5,2.50E+3,-0,0.1234567890123456789,123456789012345678901234,7,-8]", out);
+    generator.Stringify(v, out);
+    EXPECT_EQ(content, out);
+
+    // 复用解析器时回收原文负载
+    parser.Parse(v, "[0.00000000000000001]", status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_DOUBLE_EQ(1e-17, v.GetArrayElement(0).GetNumber());
+
+    // 溢出与格式错误的报错不变
+    parser.Parse(v, "1e400", status);
+    EXPECT_EQ("parse number too big", status);
+    parser.Parse(v, "1.5e-400", status);
+    EXPECT_EQ("parse ok", status);
+    parser.Parse(v, "[1.]", status);
+    EXPECT_EQ("parse invalid value", status);
+}
+
+// 测试解析的资源上限
+TEST(TestParseLimits, ParseLimits)
+{
+    SJson::JsonParser parser;
+    SJson::Json v;
+    const std::string content = "{\"name\":\"abcdefgh\",\"tags\":[1,2,3,4],\"nested\":{\"x\":null}}";
+
+    // 节点：根对象、name、tags 及 4 个元素、nested 及 x，共 9 个
+    parser.SetMaxNodes(9);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse ok", status);
+    parser.SetMaxNodes(8);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse limit exceeded", status);
+    EXPECT_EQ(SJson::JsonStatus::LimitExceeded, SJson::JsonStatus::FromMessage(status.c_str()));
+    EXPECT_EQ(SJson::JsonType::Null, v.GetType());
+    parser.SetMaxNodes(0);
+
+    parser.SetMaxStringLength(8);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse ok", status);
+    parser.SetMaxStringLength(7);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse limit exceeded", status);
+    // 解码出的长度一超过限制就停止，出错位置在超出的那个字符之后
+    EXPECT_EQ(strlen("{\"name\":\"abcdefgh"), parser.GetErrorOffset());
+    parser.SetMaxStringLength(4);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse limit exceeded", status);
+    EXPECT_EQ(strlen("{\"name\":\"abcde"), parser.GetErrorOffset());
+    // 超长的字符串与 key 都不会被解码到结尾
+    const std::string huge(1 << 20, 'x');
+    parser.SetMaxStringLength(16);
+    parser.Parse(v, "[\"" + huge + "\"]", status);
+    EXPECT_EQ("parse limit exceeded", status);
+    EXPECT_EQ(2u + 17u, parser.GetErrorOffset());
+    parser.Parse(v, "{\"" + huge + "\":1}", status);
+    EXPECT_EQ("parse limit exceeded", status);
+    EXPECT_EQ(2u + 17u, parser.GetErrorOffset());
+    parser.SetMaxStringLength(0);
+
+    parser.SetMaxContainerSize(4);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse ok", status);
+    parser.SetMaxContainerSize(3);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse limit exceeded", status);
+    parser.SetMaxContainerSize(0);
+
+    // 字节数随文档增长，大数组在中途停止
+    std::string big = "[";
+    for (int i = 0; i < 10000; ++i)
+        big += i ? ",\"0123456789abcdef0123456789\"" : "\"0123456789abcdef0123456789\"";
+    big += "]";
+    parser.SetMaxBytes(64 * 1024);
+    parser.Parse(v, content, status);
+    EXPECT_EQ("parse ok", status);
+    parser.Parse(v, big, status);
+    EXPECT_EQ("parse limit exceeded", status);
+    EXPECT_LT(parser.GetErrorOffset(), big.size() / 2);
+    parser.SetMaxBytes(0);
+    parser.Parse(v, big, status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_EQ(10000u, v.GetArraySize());
+}
+
+// 测试二进制快照
+TEST(TestSnapshot, Snapshot)
+{
+    using namespace SJson;
+    SJson::Json v;
+    v.Parse("{\"n\":null,\"t\":true,\"d\":1.5,\"s\":\"abc\",\"a\":[1,2,{\"s\":\"x\"}],\"o\":{\"n\":null}}");
+
+    std::string buffer;
+    JsonSnapshot::Write(v, buffer);
+    JsonSnapshot snapshot;
+    snapshot.Load(buffer.data(), buffer.size(), status);
+    EXPECT_EQ("load ok", status);
+
+    JsonSnapshotView root = snapshot.GetRoot();
+    EXPECT_EQ(JsonType::Object, root.GetType());
+    EXPECT_EQ(6, root.GetObjectSize());
+    EXPECT_EQ("d", root.GetObjectKey(2));
+    EXPECT_EQ(1.5, root.GetObjectValue(2).GetNumber());
+    EXPECT_EQ("abc", root.GetObjectValue(root.FindObjectIndex("s")).GetString());
+    EXPECT_EQ(-1, root.FindObjectIndex("x"));
+    JsonSnapshotView a = root.GetObjectValue(4);
+    EXPECT_EQ(3, a.GetArraySize());
+    EXPECT_EQ(2.0, a.GetArrayElement(1).GetNumber());
+    EXPECT_EQ("x", a.GetArrayElement(2).GetObjectValue(0).GetString());
+
+    SJson::Json back;
+    root.ToJson(back);
+    EXPECT_EQ(1, int(back == v));
+
+    JsonSnapshot::WriteFile(v, "snapshot_test.bin");
+    JsonSnapshot mapped;
+    mapped.Map("snapshot_test.bin", status);
+    EXPECT_EQ("load ok", status);
+    mapped.GetRoot().ToJson(back);
+    EXPECT_EQ(1, int(back == v));
+    mapped.Close();
+    std::remove("snapshot_test.bin");
+
+    snapshot.Load("SJSBxxxx", 8, status);
+    EXPECT_EQ("snapshot invalid header", status);
+    EXPECT_EQ(JsonType::Null, snapshot.GetRoot().GetType());
+
+    // 截断的快照、会回绕的根偏移
+    snapshot.Load(buffer.data(), buffer.size() - 8, status);
+    EXPECT_EQ("snapshot invalid header", status);
+    std::string corrupt = buffer;
+    uint32_t off = 0xFFFFFFF8;
+    memcpy(&corrupt[12], &off, 4);
+    snapshot.Load(corrupt.data(), corrupt.size(), status);
+    EXPECT_EQ("snapshot invalid header", status);
+
+    // 根对象第一个成员的值指向根自身、越界的 key 编号：加载时遍历节点表发现
+    uint32_t rootOff;
+    memcpy(&rootOff, &buffer[12], 4);
+    corrupt = buffer;
+    memcpy(&corrupt[rootOff + 12], &rootOff, 4);
+    snapshot.Load(corrupt.data(), corrupt.size(), status);
+    EXPECT_EQ("snapshot corrupt", status);
+    corrupt = buffer;
+    off = 1000;
+    memcpy(&corrupt[rootOff + 8], &off, 4);
+    snapshot.Load(corrupt.data(), corrupt.size(), status);
+    EXPECT_EQ("snapshot corrupt", status);
+    // 关闭校验后只检查头部
+    snapshot.SetVerify(false);
+    snapshot.Load(corrupt.data(), corrupt.size(), status);
+    EXPECT_EQ("load ok", status);
+}
+
+struct TestPoint
+{
+    int x = 0;
+    int y = 0;
+};
+SJSON_REFLECT(TestPoint, x, y)
+
+struct TestShape
+{
+    std::string name;
+    bool closed = false;
+    double scale = 0;
+    std::vector<TestPoint> points;
+    std::optional<std::string> color;
+    std::map<std::string, int> attributes;
+    std::string description_with_a_long_name;
+    std::vector<bool> flags;
+};
+SJSON_REFLECT(TestShape, name, closed, scale, points, color, attributes, description_with_a_long_name, flags)
+
+// 测试直接解析到结构体
+TEST(TestParseStruct, ParseStruct)
+{
+    TestShape shape;
+    SJson::ParseStruct("{\"name\":\"tri\",\"unknown\":{\"a\":[1,{\"b\":\"\\u0041\"}],\"c\":null},"
+                       "\"closed\":true,\"scale\":1.5,\"points\":[{\"x\":1,\"y\":2},{\"y\":4,\"x\":3,\"z\":0}],"
+                       "\"color\":null,\"attributes\":{\"w\":1,\"h\":2},"
+                       "\"description_with_a_long_name\":\"d\",\"description_with_a_long_nam\\u0065\":\"e\"}",
+                       shape, status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_EQ("tri", shape.name);
+    EXPECT_TRUE(shape.closed);
+    EXPECT_EQ(1.5, shape.scale);
+    ASSERT_EQ(2, shape.points.size());
+    EXPECT_EQ(1, shape.points[0].x);
+    EXPECT_EQ(2, shape.points[0].y);
+    EXPECT_EQ(3, shape.points[1].x);
+    EXPECT_EQ(4, shape.points[1].y);
+    EXPECT_FALSE(shape.color.has_value());
+    EXPECT_EQ(2, shape.attributes.size());
+    EXPECT_EQ(2, shape.attributes["h"]);
+    EXPECT_EQ("e", shape.description_with_a_long_name);
+
+    SJson::ParseStruct("{\"color\":\"red\",\"points\":[]}", shape, status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_EQ("red", *shape.color);
+    EXPECT_EQ(0, shape.points.size());
+
+    SJson::ParseStruct("{\"points\":[{\"x\":1.5}]}", shape, status);
+    EXPECT_EQ("parse type mismatch", status);
+    SJson::ParseStruct("{\"name\":1}", shape, status);
+    EXPECT_EQ("parse type mismatch", status);
+    // 跳过的值同样校验代理项
+    SJson::ParseStruct("{\"unknown\":\"\\uDC00\"}", shape, status);
+    EXPECT_EQ("parse invalid unicode surrogate", status);
+    // 跳过的数字只校验不转换，溢出仍然报错
+    SJson::ParseStruct("{\"unknown\":[1e308,-0.5E-400,123456789012345678901234567890]}", shape, status);
+    EXPECT_EQ("parse ok", status);
+    SJson::ParseStruct("{\"unknown\":[1,1e309]}", shape, status);
+    EXPECT_EQ("parse number too big", status);
+    SJson::ParseStruct("{\"unknown\":[1.]}", shape, status);
+    EXPECT_EQ("parse invalid value", status);
+    SJson::ParseStruct("{\"unknown\":[1,}", shape, status);
+    EXPECT_EQ("parse invalid value", status);
+    SJson::ParseStruct("{\"unknown\":{\"a\":1]}", shape, status);
+    EXPECT_EQ("parse miss comma or curly bracket", status);
+    SJson::ParseStruct("{\"name\":\"a\"} x", shape, status);
+    EXPECT_EQ("parse root not singular", status);
+
+    // 长度相差 256 的倍数、前 7 个字节相同的 key 不是同一个字段
+    std::string longKey = "{\"name";
+    for (int i = 0; i < 256; ++i)
+        longKey += "\\u0000";
+    longKey += "\":\"z\"}";
+    shape.name = "tri";
+    SJson::ParseStruct(longKey, shape, status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_EQ("tri", shape.name);
+}
+
+// 测试直接从结构体生成 json
+TEST(TestStringifyStruct, StringifyStruct)
+{
+    TestShape shape;
+    shape.name = "a\"b";
+    shape.closed = true;
+    shape.scale = 0.5;
+    shape.points.push_back(TestPoint{1, -2});
+    shape.attributes["k"] = 7;
+    shape.flags = {true, false, true};
+    std::string out;
+    SJson::StringifyStruct(shape, out);
+    EXPECT_EQ("{\"name\":\"a\\\"b\",\"closed\":true,\"scale\":0.5,\"points\":[{\"x\":1,\"y\":-2}],"
+              "\"color\":null,\"attributes\":{\"k\":7},\"description_with_a_long_name\":\"\",\"flags\":[true,false,true]}",
+              out);
+
+    // 生成的结果可以被 DOM 解析，也可以再解析回结构体
+    SJson::Json v;
+    v.Parse(out, status);
+    EXPECT_EQ("parse ok", status);
+    TestShape back;
+    SJson::ParseStruct(out, back, status);
+    EXPECT_EQ("parse ok", status);
+    EXPECT_EQ(shape.name, back.name);
+    EXPECT_EQ(-2, back.points[0].y);
+    EXPECT_EQ(7, back.attributes["k"]);
+    EXPECT_EQ(shape.flags, back.flags);
+}